@@ -20,8 +20,11 @@
 #define OPEN_MANIPULATOR_CONTROLLER_H
 
 #include <ros/ros.h>
+#include <ros/package.h>
+#include <urdf/model.h>
 #include <sensor_msgs/JointState.h>
 #include <geometry_msgs/PoseStamped.h>
+#include <geometry_msgs/Twist.h>
 #include <std_msgs/Float64.h>
 #include <std_msgs/String.h>
 #include <boost/thread.hpp>
@@ -52,6 +55,8 @@
 
 #include "open_manipulator_libs/OpenManipulator.h"
 
+#define ACTUATOR_TEMPERATURE_WARNING 70.0 // degC, below the Temperature Limit (80) of the X-series
+
 namespace open_manipulator_controller
 {
 
@@ -67,15 +72,20 @@ class OM_CONTROLLER
   bool using_moveit_;
   double control_period_;
   double moveit_sampling_time_;
+  double task_velocity_timeout_;
 
   // ROS Publisher
   ros::Publisher open_manipulator_state_pub_;
   std::vector<ros::Publisher> open_manipulator_kinematics_pose_pub_;
+  std::vector<ros::Publisher> open_manipulator_manipulability_pub_;
+  std::vector<ros::Publisher> open_manipulator_min_singular_value_pub_;
+  std::vector<std::string> open_manipulator_tool_name_;
   ros::Publisher open_manipulator_joint_states_pub_;
   std::vector<ros::Publisher> gazebo_goal_joint_position_pub_;
 
   // ROS Subscribers
   ros::Subscriber open_manipulator_option_sub_;
+  std::vector<ros::Subscriber> goal_task_space_velocity_sub_;
 
   ros::Subscriber display_planned_path_sub_;
 
@@ -127,6 +137,7 @@ class OM_CONTROLLER
 
   void printManipulatorSettingCallback(const std_msgs::String::ConstPtr &msg);
   void displayPlannedPathMsgCallback(const moveit_msgs::DisplayTrajectory::ConstPtr &msg);
+  void goalTaskSpaceVelocityCallback(const geometry_msgs::Twist::ConstPtr &msg, const std::string tool_name);
 
   double getControlPeriod(void){return control_period_;}
 
@@ -184,8 +195,14 @@ class OM_CONTROLLER
 
   void publishOpenManipulatorStates();
   void publishKinematicsPose();
+  void publishManipulability();
   void publishJointStates();
   void publishGazeboCommand();
+  void checkActuatorMonitor();
+
+  // links and joints of a parsed URDF for the dynamics and the collision of the libs
+  bool convertDescription(const urdf::Model &urdf_model, URDF::Model *description);
+  std::string resolveMeshFileName(const std::string &uri);
 
   bool calcPlannedPath(const std::string planning_group, open_manipulator_msgs::JointPosition msg);
   bool calcPlannedPath(const std::string planning_group, open_manipulator_msgs::KinematicsPose msg);
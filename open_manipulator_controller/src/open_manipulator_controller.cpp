@@ -29,15 +29,82 @@ OM_CONTROLLER::OM_CONTROLLER(std::string usb_port, std::string baud_rate)
      using_platform_(false),
      using_moveit_(false),
      control_period_(0.010f),
-     moveit_sampling_time_(0.050f)
+     moveit_sampling_time_(0.050f),
+     task_velocity_timeout_(0.1f)
 {
   control_period_ = priv_node_handle_.param<double>("control_period", 0.010f);
   moveit_sampling_time_ = priv_node_handle_.param<double>("moveit_sample_duration", 0.050f);
+  task_velocity_timeout_ = priv_node_handle_.param<double>("task_velocity_timeout", 0.1f);
   using_platform_ = priv_node_handle_.param<bool>("using_platform", false);
   using_moveit_ = priv_node_handle_.param<bool>("using_moveit", false);
   std::string planning_group_name = priv_node_handle_.param<std::string>("planning_group_name", "arm");
+  std::string reachability_map = priv_node_handle_.param<std::string>("reachability_map", "");
+  bool ik_multi_start = priv_node_handle_.param<bool>("ik_multi_start", false);
+  std::string kinematics = priv_node_handle_.param<std::string>("kinematics", "chain");
+  std::string dynamics_description = priv_node_handle_.param<std::string>("dynamics_description", "");
+  std::string joint_control_mode = priv_node_handle_.param<std::string>("joint_control_mode", "position_mode");
+  std::string collision_description = priv_node_handle_.param<std::string>("collision_description", "");
+  bool bus_thread = priv_node_handle_.param<bool>("bus_thread", false);
+
+  // URDF file of the link inertials, loaded before the joint control mode is set on the actuators
+  urdf::Model dynamics_model;
+  URDF::Model dynamics;
+  bool dynamics_parsed = false;
+  if (dynamics_description != "")
+    dynamics_parsed = dynamics_model.initFile(dynamics_description) && convertDescription(dynamics_model, &dynamics);
+
+  open_manipulator_.initManipulator(using_platform_, usb_port, baud_rate, kinematics,
+                                    joint_control_mode, dynamics_parsed ? &dynamics : NULL);
+
+  if (dynamics_description != "")
+  {
+    if (open_manipulator_.isDynamicsLoaded())
+      ROS_INFO("Loaded the link inertials of %s", dynamics_description.c_str());
+    else
+      ROS_WARN("Failed to load the link inertials of %s", dynamics_description.c_str());
+  }
+
+  if (joint_control_mode != "position_mode")
+  {
+    if (open_manipulator_.getJointControlMode() == joint_control_mode)
+      ROS_INFO("Joint control mode : %s", joint_control_mode.c_str());
+    else
+      ROS_WARN("Failed to set the joint control mode %s, keep position_mode", joint_control_mode.c_str());
+  }
 
-  open_manipulator_.initManipulator(using_platform_, usb_port, baud_rate);
+  if (reachability_map != "")
+  {
+    if (open_manipulator_.loadReachabilityMap(reachability_map))
+      ROS_INFO("Loaded the reachability map %s", reachability_map.c_str());
+    else
+      ROS_WARN("Failed to load the reachability map %s", reachability_map.c_str());
+  }
+
+  if (ik_multi_start)
+  {
+    open_manipulator_.setIKMultiStart(true);
+    ROS_INFO("Inverse kinematics from several seeds, the in-limit solution nearest to the present");
+  }
+
+  if (collision_description != "")
+  {
+    // parameter of the expanded robot description
+    urdf::Model urdf_model;
+    URDF::Model description;
+    if (urdf_model.initParam(collision_description) && convertDescription(urdf_model, &description) &&
+        open_manipulator_.loadCollision(description))
+      ROS_INFO("Loaded the collision geometry of %s", collision_description.c_str());
+    else
+      ROS_WARN("Failed to load the collision geometry of %s", collision_description.c_str());
+  }
+
+  if (bus_thread && using_platform_)
+  {
+    if (open_manipulator_.setBusThread(true))
+      ROS_INFO("Dynamixel transactions on the bus thread");
+    else
+      ROS_WARN("Failed to start the bus thread, the control thread keeps the Dynamixel transactions");
+  }
 
   if (using_platform_ == true)    ROS_INFO("Succeeded to init %s", priv_node_handle_.getNamespace().c_str());
   else if (using_platform_ == false)    ROS_INFO("Ready to simulate %s on Gazebo", priv_node_handle_.getNamespace().c_str());
@@ -102,7 +169,12 @@ void *OM_CONTROLLER::timerThread(void *param)
     next_time.tv_nsec = (next_time.tv_nsec + ((int)(controller->getControlPeriod() * 1000)) * 1000000) % 1000000000;
 
     double time = next_time.tv_sec + (next_time.tv_nsec*0.000000001);
+
+    // inverse kinematics may use up to half of the period, then it returns the best so far
+    double kinematics_deadline = (time - controller->getControlPeriod() * 0.5) * 1000000.0;
+    controller->open_manipulator_.setKinematicsDeadline(kinematics_deadline);
     controller->process(time);
+    controller->open_manipulator_.setKinematicsDeadline(0.0);
 
     clock_gettime(CLOCK_MONOTONIC, &curr_time);
 
@@ -131,7 +203,13 @@ void OM_CONTROLLER::initPublisher()
     ros::Publisher pb;
     pb = priv_node_handle_.advertise<open_manipulator_msgs::KinematicsPose>(name + "/kinematics_pose", 10);
     open_manipulator_kinematics_pose_pub_.push_back(pb);
+
+    pb = priv_node_handle_.advertise<std_msgs::Float64>(name + "/manipulability", 10);
+    open_manipulator_manipulability_pub_.push_back(pb);
+    pb = priv_node_handle_.advertise<std_msgs::Float64>(name + "/min_singular_value", 10);
+    open_manipulator_min_singular_value_pub_.push_back(pb);
   }
+  open_manipulator_tool_name_ = opm_tools_name;
   open_manipulator_state_pub_ = priv_node_handle_.advertise<open_manipulator_msgs::OpenManipulatorState>("states", 10);
 
   if(using_platform_ == true)
@@ -160,6 +238,15 @@ void OM_CONTROLLER::initSubscriber()
 {
   // msg subscriber
   open_manipulator_option_sub_ = priv_node_handle_.subscribe("option", 10, &OM_CONTROLLER::printManipulatorSettingCallback, this);
+
+  auto opm_tools_name = open_manipulator_.getManipulator()->getAllToolComponentName();
+  for (auto const& name:opm_tools_name)
+  {
+    ros::Subscriber sb;
+    sb = priv_node_handle_.subscribe<geometry_msgs::Twist>(name + "/goal_task_space_velocity", 10,
+                                                           boost::bind(&OM_CONTROLLER::goalTaskSpaceVelocityCallback, this, _1, name));
+    goal_task_space_velocity_sub_.push_back(sb);
+  }
   if (using_moveit_ == true)
   {
     display_planned_path_sub_ = node_handle_.subscribe("/move_group/display_planned_path", 100,
@@ -208,6 +295,16 @@ void OM_CONTROLLER::displayPlannedPathMsgCallback(const moveit_msgs::DisplayTraj
   moveit_plan_flag_ = true;
 }
 
+void OM_CONTROLLER::goalTaskSpaceVelocityCallback(const geometry_msgs::Twist::ConstPtr &msg, const std::string tool_name)
+{
+  KINEMATICS::Vector6d twist;
+  twist << msg->linear.x, msg->linear.y, msg->linear.z,
+           msg->angular.x, msg->angular.y, msg->angular.z;
+
+  // integrated every control tick until no new velocity comes in for task_velocity_timeout
+  open_manipulator_.setTaskVelocity(tool_name, twist, task_velocity_timeout_);
+}
+
 bool OM_CONTROLLER::goalJointSpacePathCallback(open_manipulator_msgs::SetJointPosition::Request  &req,
                                                open_manipulator_msgs::SetJointPosition::Response &res)
 {
@@ -216,6 +313,14 @@ bool OM_CONTROLLER::goalJointSpacePathCallback(open_manipulator_msgs::SetJointPo
   for(int i = 0; i < req.joint_position.joint_name.size(); i ++)
     target_angle.push_back(req.joint_position.position.at(i));
 
+  std::string reason;
+  if (open_manipulator_.isCollisionFree(target_angle, &reason) == false)
+  {
+    ROS_WARN("Rejected the joint space path : collision of %s", reason.c_str());
+    res.is_planned = false;
+    return true;
+  }
+
   open_manipulator_.jointTrajectoryMove(target_angle, req.path_time);
 
   res.is_planned = true;
@@ -235,6 +340,15 @@ bool OM_CONTROLLER::goalTaskSpacePathCallback(open_manipulator_msgs::SetKinemati
                         req.kinematics_pose.pose.orientation.z);
 
   target_pose.orientation = RM_MATH::convertQuaternionToRotation(q);
+
+  std::string reason;
+  if (open_manipulator_.checkTaskSpaceGoal(req.end_effector_name, target_pose, &reason) == false)
+  {
+    ROS_WARN("Rejected the task space path : %s", reason.c_str());
+    res.is_planned = false;
+    return true;
+  }
+
   open_manipulator_.taskTrajectoryMove(req.end_effector_name, target_pose, req.path_time);
 
   res.is_planned = true;
@@ -250,6 +364,14 @@ bool OM_CONTROLLER::goalTaskSpacePathPositionOnlyCallback(open_manipulator_msgs:
   position[1] = req.kinematics_pose.pose.position.y;
   position[2] = req.kinematics_pose.pose.position.z;
 
+  std::string reason;
+  if (open_manipulator_.checkTaskSpaceGoal(req.end_effector_name, position, &reason) == false)
+  {
+    ROS_WARN("Rejected the task space path : %s", reason.c_str());
+    res.is_planned = false;
+    return true;
+  }
+
   open_manipulator_.taskTrajectoryMove(req.end_effector_name, position, req.path_time);
 
   res.is_planned = true;
@@ -267,6 +389,15 @@ bool OM_CONTROLLER::goalTaskSpacePathOrientationOnlyCallback(open_manipulator_ms
                         req.kinematics_pose.pose.orientation.z);
 
   orientation = RM_MATH::convertQuaternionToRotation(q);
+
+  std::string reason;
+  if (open_manipulator_.checkTaskSpaceGoal(req.end_effector_name, orientation, &reason) == false)
+  {
+    ROS_WARN("Rejected the task space path : %s", reason.c_str());
+    res.is_planned = false;
+    return true;
+  }
+
   open_manipulator_.taskTrajectoryMove(req.end_effector_name, orientation, req.path_time);
 
   res.is_planned = true;
@@ -281,6 +412,20 @@ bool OM_CONTROLLER::goalJointSpacePathToPresentCallback(open_manipulator_msgs::S
   for(int i = 0; i < req.joint_position.joint_name.size(); i ++)
     target_angle.push_back(req.joint_position.position.at(i));
 
+  std::vector<double> present_angle;
+  open_manipulator_.getPresentJointValue(&present_angle);
+  std::vector<double> goal_angle;
+  for(int i = 0; i < target_angle.size() && i < present_angle.size(); i ++)
+    goal_angle.push_back(present_angle.at(i) + target_angle.at(i));
+
+  std::string reason;
+  if (open_manipulator_.isCollisionFree(goal_angle, &reason) == false)
+  {
+    ROS_WARN("Rejected the joint space path : collision of %s", reason.c_str());
+    res.is_planned = false;
+    return true;
+  }
+
   open_manipulator_.jointTrajectoryMoveToPresentValue(target_angle, req.path_time);
 
   res.is_planned = true;
@@ -617,6 +762,21 @@ void OM_CONTROLLER::publishKinematicsPose()
   }
 }
 
+void OM_CONTROLLER::publishManipulability()
+{
+  std_msgs::Float64 manipulability_msg;
+  std_msgs::Float64 min_singular_value_msg;
+
+  for (uint8_t index = 0; index < open_manipulator_tool_name_.size(); index++)
+  {
+    if (open_manipulator_.getManipulability(open_manipulator_tool_name_.at(index), &manipulability_msg.data, &min_singular_value_msg.data) == false)
+      continue;
+
+    open_manipulator_manipulability_pub_.at(index).publish(manipulability_msg);
+    open_manipulator_min_singular_value_pub_.at(index).publish(min_singular_value_msg);
+  }
+}
+
 void OM_CONTROLLER::publishJointStates()
 {
   sensor_msgs::JointState msg;
@@ -670,13 +830,149 @@ void OM_CONTROLLER::publishGazeboCommand()
   }
 }
 
+bool OM_CONTROLLER::convertDescription(const urdf::Model &urdf_model, URDF::Model *description)
+{
+  description->clear();
+
+  for (std::map<std::string, urdf::LinkSharedPtr>::const_iterator it = urdf_model.links_.begin(); it != urdf_model.links_.end(); it++)
+  {
+    const urdf::Link &urdf_link = *it->second;
+    URDF::Link link;
+
+    link.has_inertial = static_cast<bool>(urdf_link.inertial);
+    if (link.has_inertial)
+    {
+      const urdf::Inertial &inertial = *urdf_link.inertial;
+      link.inertial.mass = inertial.mass;
+      link.inertial.origin << inertial.origin.position.x, inertial.origin.position.y, inertial.origin.position.z;
+      link.inertial.rotation = Eigen::Quaterniond(inertial.origin.rotation.w, inertial.origin.rotation.x,
+                                                  inertial.origin.rotation.y, inertial.origin.rotation.z).toRotationMatrix();
+      link.inertial.inertia << inertial.ixx, inertial.ixy, inertial.ixz,
+                               inertial.ixy, inertial.iyy, inertial.iyz,
+                               inertial.ixz, inertial.iyz, inertial.izz;
+    }
+
+    for (uint8_t index = 0; index < urdf_link.collision_array.size(); index++)
+    {
+      const urdf::Collision &collision = *urdf_link.collision_array.at(index);
+      if (!collision.geometry)
+        continue;
+
+      URDF::Geometry geometry;
+      geometry.scale = Eigen::Vector3d::Ones();
+      geometry.size.setZero();
+      geometry.radius = 0.0;
+      geometry.length = 0.0;
+      geometry.origin << collision.origin.position.x, collision.origin.position.y, collision.origin.position.z;
+      geometry.rotation = Eigen::Quaterniond(collision.origin.rotation.w, collision.origin.rotation.x,
+                                             collision.origin.rotation.y, collision.origin.rotation.z).toRotationMatrix();
+
+      const urdf::Geometry *urdf_geometry = collision.geometry.get();
+      if (urdf_geometry->type == urdf::Geometry::MESH)
+      {
+        const urdf::Mesh *mesh = static_cast<const urdf::Mesh *>(urdf_geometry);
+        geometry.type = "mesh";
+        geometry.file_name = resolveMeshFileName(mesh->filename);
+        geometry.scale << mesh->scale.x, mesh->scale.y, mesh->scale.z;
+      }
+      else if (urdf_geometry->type == urdf::Geometry::BOX)
+      {
+        const urdf::Box *box = static_cast<const urdf::Box *>(urdf_geometry);
+        geometry.type = "box";
+        geometry.size << box->dim.x, box->dim.y, box->dim.z;
+      }
+      else if (urdf_geometry->type == urdf::Geometry::CYLINDER)
+      {
+        const urdf::Cylinder *cylinder = static_cast<const urdf::Cylinder *>(urdf_geometry);
+        geometry.type = "cylinder";
+        geometry.radius = cylinder->radius;
+        geometry.length = cylinder->length;
+      }
+      else if (urdf_geometry->type == urdf::Geometry::SPHERE)
+      {
+        geometry.type = "sphere";
+        geometry.radius = static_cast<const urdf::Sphere *>(urdf_geometry)->radius;
+      }
+      else
+        continue;
+
+      link.collision.push_back(geometry);
+    }
+    description->addLink(it->first, link);
+  }
+
+  for (std::map<std::string, urdf::JointSharedPtr>::const_iterator it = urdf_model.joints_.begin(); it != urdf_model.joints_.end(); it++)
+  {
+    const urdf::Joint &urdf_joint = *it->second;
+    const urdf::Pose &origin = urdf_joint.parent_to_joint_origin_transform;
+    URDF::Joint joint;
+
+    joint.name = urdf_joint.name;
+    switch (urdf_joint.type)
+    {
+      case urdf::Joint::REVOLUTE:   joint.type = "revolute";   break;
+      case urdf::Joint::CONTINUOUS: joint.type = "continuous"; break;
+      case urdf::Joint::PRISMATIC:  joint.type = "prismatic";  break;
+      case urdf::Joint::FIXED:      joint.type = "fixed";      break;
+      case urdf::Joint::FLOATING:   joint.type = "floating";   break;
+      case urdf::Joint::PLANAR:     joint.type = "planar";     break;
+      default:                      joint.type = "unknown";    break;
+    }
+    joint.parent = urdf_joint.parent_link_name;
+    joint.child = urdf_joint.child_link_name;
+    joint.origin << origin.position.x, origin.position.y, origin.position.z;
+    joint.rotation = Eigen::Quaterniond(origin.rotation.w, origin.rotation.x, origin.rotation.y, origin.rotation.z).toRotationMatrix();
+    description->addJoint(joint);
+  }
+  return (urdf_model.links_.size() > 0);
+}
+
+std::string OM_CONTROLLER::resolveMeshFileName(const std::string &uri)
+{
+  const std::string package_prefix = "package://";
+  const std::string file_prefix = "file://";
+
+  if (uri.compare(0, file_prefix.size(), file_prefix) == 0)
+    return uri.substr(file_prefix.size());
+  if (uri.compare(0, package_prefix.size(), package_prefix) != 0)
+    return uri;
+
+  size_t package_end = uri.find('/', package_prefix.size());
+  if (package_end == std::string::npos)
+    return uri;
+  return ros::package::getPath(uri.substr(package_prefix.size(), package_end - package_prefix.size())) + uri.substr(package_end);
+}
+
+void OM_CONTROLLER::checkActuatorMonitor()
+{
+  std::vector<uint8_t> actuator_id = open_manipulator_.getActuatorId();
+  for (uint8_t index = 0; index < actuator_id.size(); index++)
+  {
+    double voltage, temperature;
+    uint8_t hardware_error;
+    if (open_manipulator_.getActuatorMonitor(actuator_id.at(index), &voltage, &temperature, &hardware_error) == false)
+      continue;
+
+    if (hardware_error != 0)
+      ROS_WARN_THROTTLE(1.0, "Hardware error 0x%02X on the Dynamixel %d (%.1f V, %.0f degC)",
+                        hardware_error, actuator_id.at(index), voltage, temperature);
+    else if (temperature >= ACTUATOR_TEMPERATURE_WARNING)
+      ROS_WARN_THROTTLE(1.0, "Dynamixel %d is at %.0f degC", actuator_id.at(index), temperature);
+  }
+}
+
 void OM_CONTROLLER::publishCallback(const ros::TimerEvent&)
 {
-  if (using_platform_ == true)  publishJointStates();
+  if (using_platform_ == true)
+  {
+    publishJointStates();
+    checkActuatorMonitor();
+  }
   else  publishGazeboCommand();
 
   publishOpenManipulatorStates();
   publishKinematicsPose();
+  publishManipulability();
 }
 
 void OM_CONTROLLER::moveitTimer(double present_time)
@@ -0,0 +1,156 @@
+﻿/*******************************************************************************
+* Copyright 2018 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Authors: Darby Lim, Hye-Jong KIM, Ryan Shim, Yong-Ho Na */
+
+// Throughput of the kinematics on the OpenManipulator Chain (no actuators)
+//   inverse kinematics batch : solves/second of each solver over a smooth path
+//   chain description        : OpenManipulatorChainStatic against the generic Chain (ns per call)
+
+#include "../include/open_manipulator_libs/OpenManipulator.h"
+
+#include <chrono>
+#include <cstdio>
+
+#define BENCHMARK_PATH_SIZE 2000
+#define BENCHMARK_CALL_SIZE 1000000
+
+static double getSecond(std::chrono::steady_clock::time_point begin)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// gripper poses of a smooth joint path inside the joint limits
+static std::vector<Pose> makePath(Manipulator *manipulator, KINEMATICS::Chain *chain)
+{
+  std::vector<Pose> path;
+  for (uint32_t index = 0; index < BENCHMARK_PATH_SIZE; index++)
+  {
+    double s = (double)index / BENCHMARK_PATH_SIZE;
+    std::vector<double> joint_value;
+    joint_value.push_back(0.8 * sin(2.0 * M_PI * s));
+    joint_value.push_back(0.3 + 0.4 * sin(4.0 * M_PI * s));
+    joint_value.push_back(-0.5 + 0.3 * cos(2.0 * M_PI * s));
+    joint_value.push_back(0.4 * sin(6.0 * M_PI * s));
+    manipulator->setAllActiveJointValue(joint_value);
+    chain->forwardKinematics(manipulator);
+
+    Pose pose;
+    pose.position = manipulator->getComponentPositionFromWorld("gripper");
+    pose.orientation = manipulator->getComponentOrientationFromWorld("gripper");
+    path.push_back(pose);
+  }
+  return path;
+}
+
+static void benchmarkInverseKinematicsBatch(Manipulator *manipulator)
+{
+  const char *solver[4] = {"sr_inverse", "position_only_inverse", "chain_custum_inverse_kinematics", "analytic_inverse"};
+
+  KINEMATICS::Chain chain;
+  chain.buildForwardKinematicsPlan(manipulator);
+  chain.setJointLimit("joint1", JOINT1_MAX_LIMIT, JOINT1_MIN_LIMIT);
+  chain.setJointLimit("joint2", JOINT2_MAX_LIMIT, JOINT2_MIN_LIMIT);
+  chain.setJointLimit("joint3", JOINT3_MAX_LIMIT, JOINT3_MIN_LIMIT);
+  chain.setJointLimit("joint4", JOINT4_MAX_LIMIT, JOINT4_MIN_LIMIT);
+
+  std::vector<Pose> path = makePath(manipulator, &chain);
+  std::vector<std::vector<double> > seed; // warm start from the previous solution
+
+  printf("inverse kinematics batch (%d poses)\n", BENCHMARK_PATH_SIZE);
+  for (uint8_t index = 0; index < 4; index++)
+  {
+    STRING option[2] = {"inverse_solver", solver[index]};
+    chain.setOption(&option);
+
+    // every batch starts from the same present joint values
+    std::vector<double> present_value(NUM_OF_JOINT, 0.0);
+    present_value.at(1) = 0.3;
+    present_value.at(2) = -0.2;
+    manipulator->setAllActiveJointValue(present_value);
+    chain.forwardKinematics(manipulator);
+
+    std::vector<KINEMATICS::IKResult> result;
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    chain.inverseKinematicsBatch(manipulator, "gripper", path, seed, &result);
+    double second = getSecond(begin);
+
+    uint32_t success = 0;
+    for (uint32_t pose = 0; pose < result.size(); pose++)
+      success += result.at(pose).success;
+    printf("  %-32s %8.0f solves/s  %u/%u solved\n", solver[index], BENCHMARK_PATH_SIZE / second, success, BENCHMARK_PATH_SIZE);
+  }
+}
+
+static void benchmarkChainStatic(Manipulator *manipulator)
+{
+  KINEMATICS::Chain chain;
+  KINEMATICS::OpenManipulatorChainStatic chain_static;
+  KINEMATICS::Chain *kinematics[2] = {&chain, &chain_static};
+  const char *kinematics_name[2] = {"Chain", "OpenManipulatorChainStatic"};
+  chain.buildForwardKinematicsPlan(manipulator);
+  chain_static.buildForwardKinematicsPlan(manipulator);
+
+  printf("chain description (%d calls, ns per call)\n", BENCHMARK_CALL_SIZE);
+  double sum = 0.0;
+  for (uint8_t index = 0; index < 2; index++)
+  {
+    // joint2 moves on every call, nothing is cached between them
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    for (uint32_t call = 0; call < BENCHMARK_CALL_SIZE; call++)
+    {
+      manipulator->setValue("joint2", 1e-6 * call);
+      kinematics[index]->forwardKinematics(manipulator);
+    }
+    double forward_second = getSecond(begin);
+
+    begin = std::chrono::steady_clock::now();
+    for (uint32_t call = 0; call < BENCHMARK_CALL_SIZE; call++)
+    {
+      manipulator->setValue("joint2", 1e-6 * call);
+      sum += kinematics[index]->jacobian(manipulator, "gripper")(0, 0);
+    }
+    double jacobian_second = getSecond(begin);
+
+    printf("  %-32s forwardKinematics %6.0f  jacobian %6.0f\n", kinematics_name[index],
+           forward_second * 1e9 / BENCHMARK_CALL_SIZE, jacobian_second * 1e9 / BENCHMARK_CALL_SIZE);
+  }
+
+  // raw joint arrays, without the manipulator
+  double joint_value[4] = {0.1, 0.2, -0.3, 0.4};
+  Eigen::Vector3d position[5];
+  Eigen::Matrix3d orientation[5];
+  Eigen::Matrix<double, 6, 4> jacobian;
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  for (uint32_t call = 0; call < BENCHMARK_CALL_SIZE; call++)
+  {
+    joint_value[1] = 1e-6 * call;
+    KINEMATICS::OpenManipulatorChainStatic::forwardWithJacobian(joint_value, position, orientation, &jacobian);
+    sum += jacobian(0, 0);
+  }
+  printf("  %-32s forwardWithJacobian %6.0f\n", kinematics_name[1], getSecond(begin) * 1e9 / BENCHMARK_CALL_SIZE);
+  printf("  (checksum %g)\n", sum);
+}
+
+int main()
+{
+  OPEN_MANIPULATOR open_manipulator;
+  open_manipulator.initManipulator(false);
+
+  benchmarkInverseKinematicsBatch(open_manipulator.getManipulator());
+  benchmarkChainStatic(open_manipulator.getManipulator());
+  return 0;
+}
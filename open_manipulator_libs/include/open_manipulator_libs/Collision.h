@@ -0,0 +1,110 @@
+﻿/*******************************************************************************
+* Copyright 2018 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Authors: Darby Lim, Hye-Jong KIM, Ryan Shim, Yong-Ho Na */
+
+#ifndef COLLISION_H_
+#define COLLISION_H_
+
+#include "Kinematics.h"
+#include "Urdf.h"
+
+using namespace Eigen;
+using namespace ROBOTIS_MANIPULATOR;
+
+namespace COLLISION
+{
+
+typedef struct
+{
+  Name link;
+  int8_t body;                          // index of the joint carrying it (-1 : base, fixed to the world)
+  Eigen::Vector3d begin;                // segment on the joint frame (world for the base)
+  Eigen::Vector3d end;
+  double radius;
+} Capsule;
+
+/*****************************************************************************
+** Collision context : scratch memory of the checks of one thread
+*****************************************************************************/
+typedef struct
+{
+  uint32_t version;                     // copied again when the chain or the capsules change
+  KINEMATICS::IKWorkspace workspace;
+
+  // capsules on the world
+  std::vector<Eigen::Vector3d> begin;
+  std::vector<Eigen::Vector3d> end;
+} CollisionContext;
+
+/*****************************************************************************
+** Chain collision : a bounding capsule on each collision geometry of the links
+**                   self collision of bodies that are not next to each other and the base plane,
+**                   posed with the FK of the IK workspace (a joint space path in a few us)
+**                   re-entrant, every thread checks on its own collision context
+**                   the chain, the capsules, the margin and the plane are set before the threads start
+*****************************************************************************/
+class ChainCollision
+{
+private:
+  uint32_t id_;                         // key of the collision contexts
+  std::atomic<uint32_t> version_;
+  KINEMATICS::IKWorkspace workspace_;   // copied to the contexts
+  std::vector<Name> joint_name_;
+#if defined(__OPENCR__)
+  CollisionContext context_;
+#endif
+
+  std::vector<Capsule> capsule_;
+  std::vector<std::pair<uint8_t, uint8_t> > pair_;  // capsule index of the checked pairs
+  std::vector<uint8_t> plane_capsule_;               // capsule index checked on the base plane
+  double margin_;                       // m
+  double plane_height_;                 // m, z on the world
+
+  CollisionContext *getContext();
+  void placeCapsule(CollisionContext *context, const std::vector<double> &joint_value);
+  bool checkPlacedCapsule(CollisionContext *context, STRING *reason);
+
+public:
+  ChainCollision();
+  ~ChainCollision(){}
+
+  bool build(Manipulator *manipulator, Name tool_name);
+  // capsules fitted on the collision meshes (binary or ascii STL) and primitives of the links, after build
+  bool loadDescription(const URDF::Model &model);
+  // joint_name "" : fixed to the world
+  bool addCapsule(Name link_name, Name joint_name, Eigen::Vector3d begin, Eigen::Vector3d end, double radius);
+  void clearCapsule();
+  // checked pairs : different bodies, not next to each other and apart at the zero pose (same for the base plane)
+  void updatePair();
+  void setMargin(double margin){margin_ = margin; updatePair();}
+  void setPlaneHeight(double height){plane_height_ = height; updatePair();}
+
+  bool isLoaded(){return (capsule_.size() > 0);}
+  // true : collision, reason as "link5 - link1" or "link5 - base plane"
+  bool isCollided(const std::vector<double> &joint_value, STRING *reason = NULL);
+  // straight joint space line (the path of a joint trajectory), no joint moves more than max_step between samples
+  bool isPathCollided(const std::vector<double> &start_value, const std::vector<double> &goal_value,
+                      double max_step = 0.02, STRING *reason = NULL);
+
+  uint8_t getCapsuleSize(){return capsule_.size();}
+  Capsule getCapsule(uint8_t index){return capsule_.at(index);}
+  uint16_t getPairSize(){return pair_.size();}
+};
+
+} // namespace COLLISION
+
+#endif // COLLISION_H_
@@ -0,0 +1,92 @@
+﻿/*******************************************************************************
+* Copyright 2018 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Authors: Darby Lim, Hye-Jong KIM, Ryan Shim, Yong-Ho Na */
+
+#ifndef DYNAMICS_H_
+#define DYNAMICS_H_
+
+#include "Kinematics.h"
+#include "Urdf.h"
+
+#define GRAVITY_ACCELERATION 9.80665 // m/s^2
+
+using namespace Eigen;
+using namespace ROBOTIS_MANIPULATOR;
+
+namespace DYNAMICS
+{
+
+/*****************************************************************************
+** Chain dynamics : recursive Newton-Euler inverse dynamics over the active joint chain
+**                  (world child -> tool, same chain as the IK workspace)
+**                  each joint carries the links moving with it, merged into one body
+*****************************************************************************/
+class ChainDynamics
+{
+private:
+  int8_t dof_;
+  std::vector<Name> joint_name_;
+  Eigen::Vector3d gravity_;             // world
+
+  // index 0 ~ dof-1 : active joints (joint frame), from the parent joint
+  std::vector<Eigen::Vector3d> axis_;
+  std::vector<KINEMATICS::AxisType> axis_type_;
+  std::vector<Eigen::Vector3d> relative_position_;
+  Eigen::Matrix3d world_orientation_;
+
+  // body of each joint
+  std::vector<double> mass_;
+  std::vector<Eigen::Vector3d> center_of_mass_;   // joint frame
+  std::vector<Eigen::Matrix3d> inertia_;          // about the center of mass, joint frame
+
+  // recursion (sized on build, nothing is allocated per call)
+  std::vector<double> zero_value_;                // velocity and acceleration of gravityTorque
+  std::vector<Eigen::Matrix3d> rotation_;         // joint frame from the parent joint frame
+  std::vector<Eigen::Vector3d> angular_velocity_;
+  std::vector<Eigen::Vector3d> angular_acceleration_;
+  std::vector<Eigen::Vector3d> linear_acceleration_;
+  std::vector<Eigen::Vector3d> force_;
+  std::vector<Eigen::Vector3d> moment_;
+
+public:
+  ChainDynamics();
+  ~ChainDynamics(){}
+
+  bool build(Manipulator *manipulator, Name tool_name);
+  // inertials of the links of a robot description, after build
+  bool loadDescription(const URDF::Model &model);
+  // merges a link into the body of the joint (center of mass and inertia on the joint frame)
+  bool addBody(Name joint_name, double mass, Eigen::Vector3d center_of_mass, Eigen::Matrix3d inertia);
+  void clearBody();
+  void setGravity(Eigen::Vector3d gravity){gravity_ = gravity;}
+
+  // torque = M(q) * qdd + C(q, qd) * qd + G(q)
+  bool inverseDynamics(const std::vector<double> &joint_value, const std::vector<double> &joint_velocity,
+                       const std::vector<double> &joint_acceleration, std::vector<double> *joint_torque);
+  // torque = G(q)
+  bool gravityTorque(const std::vector<double> &joint_value, std::vector<double> *joint_torque);
+
+  int8_t getDOF(){return dof_;}
+  bool isLoaded();                      // a body with mass on the chain
+  double getMass(int8_t index){return mass_.at(index);}
+  Eigen::Vector3d getCenterOfMass(int8_t index){return center_of_mass_.at(index);}
+  Eigen::Matrix3d getInertia(int8_t index){return inertia_.at(index);}
+};
+
+} // namespace DYNAMICS
+
+#endif // DYNAMICS_H_
@@ -25,15 +25,26 @@
 #else
   #include <robotis_manipulator/robotis_manipulator.h>
   #include <dynamixel_workbench_toolbox/dynamixel_workbench.h>
+  #include <condition_variable>
+  #include <mutex>
+  #include <thread>
 #endif
+#include <atomic>
 
 namespace DYNAMIXEL
 {
 
 #define SYNC_WRITE_HANDLER_FOR_GOAL_POSITION 0
+#define SYNC_WRITE_HANDLER_FOR_GOAL_CURRENT_POSITION 1
 #define SYNC_READ_HANDLER_FOR_PRESENT_POSITION_VELOCITY_CURRENT 0
+#define SYNC_READ_HANDLER_FOR_PRESENT_MONITOR 1
 
 // Protocol 2.0
+// Goal_PWM ~ Goal_Position are contiguous, one 4 byte item each (Goal_PWM and Goal_Current share the first)
+#define ADDR_GOAL_PWM_2 100
+#define LENGTH_GOAL_PWM_TO_GOAL_POSITION_2 20
+#define NUM_OF_GOAL_PWM_TO_GOAL_POSITION_ITEM 5
+
 #define ADDR_PRESENT_CURRENT_2 126
 #define ADDR_PRESENT_VELOCITY_2 128
 #define ADDR_PRESENT_POSITION_2 132
@@ -41,6 +52,23 @@ namespace DYNAMIXEL
 #define LENGTH_PRESENT_CURRENT_2 2
 #define LENGTH_PRESENT_VELOCITY_2 4
 #define LENGTH_PRESENT_POSITION_2 4
+#define LENGTH_PRESENT_VALUE_2 (LENGTH_PRESENT_CURRENT_2 + LENGTH_PRESENT_VELOCITY_2 + LENGTH_PRESENT_POSITION_2)
+
+// Indirect Address (X-series) : the present values, then the monitoring items, in one region of the read
+// (Indirect Address n holds the address of the byte read at Indirect Data n)
+#define ADDR_INDIRECT_ADDRESS_1_2 168
+#define ADDR_INDIRECT_DATA_1_2 224
+
+#define ADDR_PRESENT_INPUT_VOLTAGE_2 144
+#define ADDR_PRESENT_TEMPERATURE_2 146
+#define ADDR_HARDWARE_ERROR_STATUS_2 70
+
+#define LENGTH_PRESENT_INPUT_VOLTAGE_2 2
+#define LENGTH_PRESENT_TEMPERATURE_2 1
+#define LENGTH_HARDWARE_ERROR_STATUS_2 1
+#define LENGTH_PRESENT_MONITOR_2 (LENGTH_PRESENT_VALUE_2 + LENGTH_PRESENT_INPUT_VOLTAGE_2 + LENGTH_PRESENT_TEMPERATURE_2 + LENGTH_HARDWARE_ERROR_STATUS_2)
+
+#define PRESENT_INPUT_VOLTAGE_UNIT 0.1 // V
 
 // Protocol 1.0
 #define ADDR_PRESENT_CURRENT_1 = 40;
@@ -57,14 +85,236 @@ typedef struct
   uint8_t num;
 } Joint;
 
+// registers rewritten by the goal current + goal position write (read back on the mode change)
+typedef struct
+{
+  int32_t goal_pwm;
+  int32_t goal_current;
+  int32_t profile_acceleration;
+  int32_t profile_velocity;
+  int32_t position_p_gain;
+  int32_t current_limit;
+} GoalRegister;
+
+typedef struct
+{
+  int32_t zero_position;                // value of 0 rad
+  double positive_radian;               // rad per value above zero_position
+  double negative_radian;               // rad per value below zero_position
+  double velocity;                      // rad/s per value
+  double current;                       // mA per value
+} ValueScale;
+
+typedef enum _ReadMode
+{
+  READ_SYNC = 0,                        // Sync Read : a status packet from each id
+  READ_BULK                             // Bulk Read : address of each id from the control table of its model
+} ReadMode;
+
+typedef enum _GoalType
+{
+  GOAL_NONE = 0,
+  GOAL_POSITION,                        // Goal_Position
+  GOAL_CURRENT_POSITION                 // Goal_PWM ~ Goal_Position (goal current + goal position)
+} GoalType;
+
+typedef struct
+{
+  std::vector<double> current;          // index : order of the ids, mA
+  std::vector<double> velocity;         // rad/s
+  std::vector<double> position;         // rad
+  std::vector<double> voltage;          // V (monitoring items : Indirect Address only)
+  std::vector<double> temperature;      // degC
+  std::vector<uint8_t> hardware_error;  // Hardware_Error_Status
+} PresentValue;
+
+typedef struct
+{
+  std::vector<uint8_t> type;            // GoalType
+  std::vector<int32_t> value;           // NUM_OF_GOAL_PWM_TO_GOAL_POSITION_ITEM per id
+} GoalValue;
+
+/*****************************************************************************
+** Exchange buffer : the latest value from one writer thread to one reader thread
+**                   (triple buffer, neither of them waits or allocates,
+**                    a value not taken yet is replaced by the next one)
+*****************************************************************************/
+template <typename T>
+class ExchangeBuffer
+{
+ private:
+  T buffer_[3];
+  std::atomic<uint8_t> middle_;         // buffer between the threads, bit 2 : written and not taken yet
+  uint8_t write_;                       // writer thread only
+  uint8_t read_;                        // reader thread only
+
+  ExchangeBuffer(const ExchangeBuffer &);
+  ExchangeBuffer &operator=(const ExchangeBuffer &);
+
+ public:
+  ExchangeBuffer() : middle_(1), write_(0), read_(2) {}
+
+  // before the threads start : sizes every buffer
+  void fill(const T &value)
+  {
+    for (uint8_t index = 0; index < 3; index++)
+      buffer_[index] = value;
+    middle_.store(1);
+    write_ = 0;
+    read_ = 2;
+  }
+
+  T &getWriteBuffer() {return buffer_[write_];}
+  void publish() {write_ = middle_.exchange(write_ | 4, std::memory_order_acq_rel) & 3;}
+  bool isPending() const {return (middle_.load(std::memory_order_acquire) & 4) != 0;}  // writer : the last publish not taken yet
+
+  bool take()                           // false : nothing new since the last take
+  {
+    if ((middle_.load(std::memory_order_relaxed) & 4) == 0)
+      return false;
+    read_ = middle_.exchange(read_, std::memory_order_acq_rel) & 3;
+    return true;
+  }
+  const T &getReadBuffer() {return buffer_[read_];}
+};
+
+/*****************************************************************************
+** Dynamixel bus : one port shared by the joint and the gripper actuators
+**                 (every transaction goes through the port handle of the workbench)
+**                 the actuators register their ids, each tick takes one sync read
+**                 and one sync write over all of them
+**                 (the first receive of a tick reads every id, the goals are staged
+**                  and go out when every id has one or on writeGoalValue)
+**                 with the bus thread, the goals of a tick go out and the present
+**                 values of the next tick come in while the control thread computes
+*****************************************************************************/
+class DynamixelBus
+{
+ private:
+  DynamixelWorkbench *dynamixel_workbench_;
+  STRING device_name_;
+  uint32_t baud_rate_;
+
+  bool sdk_handler_added_;
+  bool goal_current_handler_added_;
+
+  std::vector<uint8_t> id_;                         // order of the sync packets
+  PresentValue present_;                            // decoded by the thread of the transactions
+  const PresentValue *present_read_;                // taken by the control thread (present_ or a buffer of the bus thread)
+  std::vector<uint8_t> present_fresh_;              // read on this tick and not taken yet
+  std::vector<ValueScale> value_scale_;             // from the model of each id
+  std::vector<int32_t> raw_value_;                  // current, velocity, position items read by the workbench
+
+  // read transaction, chosen from the models on the first read after the ids change
+  ReadMode read_mode_;
+  bool read_mode_selected_;
+  bool indirect_address_;               // every id reads the present values and the monitoring items on its indirect data
+  bool monitor_handler_added_;
+  uint16_t read_address_;               // region of Sync Read
+  uint16_t read_length_;
+  std::vector<uint16_t> item_address_[3];           // current, velocity, position of each id
+  std::vector<uint16_t> item_length_[3];
+
+  std::vector<uint8_t> goal_type_;                  // GoalType
+  std::vector<int32_t> goal_value_;                 // NUM_OF_GOAL_PWM_TO_GOAL_POSITION_ITEM per id
+  std::map<uint8_t, GoalRegister> goal_register_;   // key : actuator id
+
+#if !defined(__OPENCR__)
+  // bus thread : owns the transactions of the cycles while it runs
+  std::thread io_thread_;
+  std::mutex port_mutex_;               // a cycle of the bus thread or a configuration of the actuators
+  std::mutex io_mutex_;
+  std::condition_variable io_condition_;
+  uint32_t io_cycle_;                   // cycles asked by the control thread (io_mutex_)
+  bool io_stop_;                        // (io_mutex_)
+  ExchangeBuffer<GoalValue> goal_buffer_;           // control thread -> bus thread
+  GoalValue goal_unsent_;                           // control thread : goals published and not taken yet, under the new ones
+  ExchangeBuffer<PresentValue> present_buffer_;     // bus thread -> control thread
+#endif
+  bool io_running_;                     // set and cleared by the control thread
+
+  DynamixelBus(STRING dxl_device_name, uint32_t dxl_baud_rate);
+  DynamixelBus(const DynamixelBus &);
+  DynamixelBus &operator=(const DynamixelBus &);
+
+  int8_t findIndex(uint8_t actuator_id);
+  bool isAllStaged();
+  bool addGoalCurrentHandler();
+
+  bool selectReadMode();
+  void convertPresentValue(uint8_t index, int16_t current, int32_t velocity, int32_t position);
+  void convertMonitorValue(uint8_t index, uint16_t voltage, uint8_t temperature, uint8_t hardware_error);
+  bool syncRead(const char **log);
+  bool bulkRead(const char **log);
+  bool takePresentValue();
+
+  bool prepareGoalValue();
+  bool sendGoalValue(const uint8_t *goal_type, const int32_t *goal_value);
+  void ioLoop();
+
+ public:
+  ~DynamixelBus() {stopIOThread();}
+
+  // one bus per port, opened on the first call
+  static DynamixelBus *getBus(STRING dxl_device_name, STRING dxl_baud_rate);
+  DynamixelWorkbench *getWorkbench() {return dynamixel_workbench_;}
+
+  bool addId(std::vector<uint8_t> actuator_id);
+  bool setSDKHandler();
+
+  std::vector<uint8_t> getId() {return id_;}
+  // X-series only, with the torque off (at init, before enabling the actuators)
+  bool setIndirectAddress();
+
+  bool readGoalRegister(std::vector<uint8_t> actuator_id);
+  void updateGoalRegister(uint8_t actuator_id, STRING item_name, int32_t value);
+  const GoalRegister *getGoalRegister(uint8_t actuator_id);  // NULL : not read
+
+  bool readPresentValue(const char **log = NULL); // log : why it failed, logged here when NULL
+  ReadMode getReadMode() {return read_mode_;}
+  bool getPresentValue(uint8_t actuator_id, double *current, double *velocity, double *position);
+  // from the last read, false without the Indirect Address (thread of the control cycles)
+  bool getMonitorValue(uint8_t actuator_id, double *voltage, double *temperature, uint8_t *hardware_error);
+
+  bool stageGoalPosition(uint8_t actuator_id, int32_t position);
+  bool stageGoalCurrentPosition(uint8_t actuator_id, int32_t goal_current, int32_t position);
+  bool writeGoalValue();
+  bool endControlCycle();               // end of a control tick : staged goals out (or to the bus thread, woken up)
+
+  // optional bus thread (not on OpenCR), after the ids and the handlers are set
+  bool startIOThread();
+  void stopIOThread();
+  bool isIOThreadRunning() {return io_running_;}
+
+  // configuration of the actuators between the cycles of the bus thread
+  void lockPort();
+  void unlockPort();
+
+  class PortLock
+  {
+   private:
+    DynamixelBus *bus_;
+   public:
+    PortLock(DynamixelBus *bus) : bus_(bus) {bus_->lockPort();}
+    ~PortLock() {bus_->unlockPort();}
+  };
+};
+
 class JointDynamixel : public ROBOTIS_MANIPULATOR::JointActuator
 {
  private:
+  DynamixelBus *bus_;
   DynamixelWorkbench *dynamixel_workbench_;
   Joint dynamixel_;
 
+  // gravity compensation mode : current based position mode with a goal current every cycle
+  bool gravity_compensation_mode_;
+  double torque_constant_;              // N*m/A
+  double current_margin_;               // mA, goal current above the feed-forward current
+
  public:
-  JointDynamixel() {}
+  JointDynamixel() : bus_(NULL), dynamixel_workbench_(NULL),
+                     gravity_compensation_mode_(false), torque_constant_(1.78), current_margin_(400.0) {}
   virtual ~JointDynamixel() {}
 
   virtual void init(std::vector<uint8_t> actuator_id, const void *arg);
@@ -81,20 +331,22 @@ class JointDynamixel : public ROBOTIS_MANIPULATOR::JointActuator
 
   bool initialize(std::vector<uint8_t> actuator_id, STRING dxl_device_name, STRING dxl_baud_rate);
   bool setOperatingMode(std::vector<uint8_t> actuator_id, STRING dynamixel_mode = "position_mode");
-  bool setSDKHandler(uint8_t actuator_id);
+  bool setSDKHandler();
   bool writeProfileValue(std::vector<uint8_t> actuator_id, STRING profile_mode, uint32_t value);
   bool writeGoalPosition(std::vector<uint8_t> actuator_id, std::vector<double> radian_vector);
+  bool writeGoalCurrentPosition(std::vector<uint8_t> actuator_id, std::vector<double> radian_vector, std::vector<double> torque_vector);
   std::vector<ROBOTIS_MANIPULATOR::Actuator> receiveAllDynamixelValue(std::vector<uint8_t> actuator_id);
 };
 
 class GripperDynamixel : public ROBOTIS_MANIPULATOR::ToolActuator
 {
  private:
+  DynamixelBus *bus_;
   DynamixelWorkbench *dynamixel_workbench_;
   Joint dynamixel_;
 
  public:
-  GripperDynamixel() {}
+  GripperDynamixel() : bus_(NULL), dynamixel_workbench_(NULL) {}
   virtual ~GripperDynamixel() {}
 
   virtual void init(uint8_t actuator_id, const void *arg);
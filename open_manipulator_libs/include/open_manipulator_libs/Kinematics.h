@@ -23,21 +23,464 @@
   #include <RobotisManipulator.h>
 #else
   #include <robotis_manipulator/robotis_manipulator.h>
+  #include <condition_variable>
+  #include <functional>
+  #include <mutex>
+  #include <thread>
 #endif
+#include <atomic>
 
 //#define KINEMATICS_DEBUG
 
+#define CHAIN_FIXED_DOF 4 // DOF solved with compile-time sized matrices (OpenManipulator Chain)
+#define REACHABILITY_MAP_VERSION 1
+#define CHAIN_STATE_SIZE 16 // links published by the control loop (larger plans are not published)
+#define ANALYTIC_SOLUTION_SIZE 4 // branches of the analytic solver (2 yaw x 2 elbow)
+
 using namespace Eigen;
 using namespace ROBOTIS_MANIPULATOR;
 
 namespace KINEMATICS
 {
+typedef Eigen::Matrix<double, 6, 1> Vector6d;
+
+typedef struct
+{
+  double max;
+  double min;
+} JointLimit;
+
+typedef enum _AxisType
+{
+  AXIS_NONE = 0,                        // no rotation (tool)
+  AXIS_X,
+  AXIS_Y,
+  AXIS_Z,
+  AXIS_OTHER                            // rodrigues rotation
+} AxisType;
+
+typedef struct
+{
+  Name name;
+  int8_t parent;                        // index of the parent link (-1 : world)
+  Eigen::Vector3d axis;
+  AxisType axis_type;
+  Eigen::Vector3d relative_position;
+  double value;                         // joint value of the cached sin/cos (NaN : not computed yet)
+  double sin_value;
+  double cos_value;
+} ForwardKinematicsLink;
+
+AxisType getAxisType(const Eigen::Vector3d &axis);
+// rotation = parent_rotation * (rotation about the axis), without the 3x3 product for the unit axes
+void rotateAboutAxis(const Eigen::Matrix3d &parent_rotation, AxisType axis_type, const Eigen::Vector3d &axis,
+                     double sin_value, double cos_value, Eigen::Matrix3d *rotation);
+
+typedef enum _IKExitReason
+{
+  IK_CONVERGED = 0,
+  IK_MAX_ITERATION,
+  IK_TIME_OUT,
+  IK_NO_SOLUTION,                       // analytic solver or out of the reachability map
+  IK_WRONG_SOLVER
+} IKExitReason;
+
+typedef enum _InverseSolverType
+{
+  INVERSE_SOLVER_UNKNOWN = 0,
+  INVERSE_SOLVER_POSITION_ONLY,         // "position_only_inverse"
+  INVERSE_SOLVER_SR,                    // "sr_inverse"
+  INVERSE_SOLVER_CHAIN_CUSTOM,          // "chain_custum_inverse_kinematics"
+  INVERSE_SOLVER_NORMAL,                // "normal_inverse"
+  INVERSE_SOLVER_ANALYTIC               // "analytic_inverse"
+} InverseSolverType;
+
+typedef enum _EnvelopeState
+{
+  ENVELOPE_NONE = 0,                    // not asked for, every goal passes
+  ENVELOPE_READY,
+  ENVELOPE_STALE,                       // a joint limit changed, rebuilt on the next check
+  ENVELOPE_BUILDING
+} EnvelopeState;
+
+typedef enum _TaskGoalKeep
+{
+  TASK_GOAL_KEEP_NONE = 0,
+  TASK_GOAL_KEEP_POSITION,              // position of the target pose ignored, the present one is checked
+  TASK_GOAL_KEEP_ORIENTATION            // orientation of the target pose ignored, the present one is checked
+} TaskGoalKeep;
+
+typedef struct
+{
+  uint16_t iteration;                   // maximum number of iterations
+  double tolerance;                     // sr solvers : stop when Ek is smaller
+  double jacobian_tolerance;            // normal solver : stop when |dx| is smaller
+  double jacobian_step;                 // normal solver : dq = step * J^-1 * dx
+  double damping;                       // sr solvers : lambda = damping_gain * Ek + damping
+  double damping_gain;
+  double rollback_gamma;                // sr solvers : undo gamma * dq when Ek gets worse
+  double time_budget;                   // us (0 : no limit)
+  double approximate_tolerance;         // accept the best so far when the time is over and its error is smaller (0 : never)
+  bool clamp_joint_limit;               // keep every iteration inside the joint limits
+  bool multi_start;                     // solve from several seeds and take the closest solution (clamped)
+  uint8_t thread;                       // workers for the multi start (0 : caller thread only, not on OpenCR)
+  double rate_damping;                  // resolved rate : dq = (J^T*W*J + rate_damping*I)^-1 * J^T*W * v
+  double rate_orientation_weight;       // resolved rate : weight of the angular velocity (linear velocity is 1)
+  double rate_max_joint_velocity;       // resolved rate : rad/s
+  double workspace_min_radius;          // task space goal check : closest tool position to the joint1 axis (m, yaw singularity)
+} IKOptions;
+
+typedef struct
+{
+  bool success;
+  double error;                         // final residual (Ek for the sr solvers, |dx| for the others)
+  uint16_t iteration;                   // iterations used
+  double time;                          // wall time (us)
+  IKExitReason exit_reason;
+  bool approximate;                     // best so far when the time was over
+  std::vector<double> joint_value;
+} IKResult;
+
+typedef struct
+{
+  double joint_value[ANALYTIC_SOLUTION_SIZE][CHAIN_FIXED_DOF];
+  uint8_t size;                         // branches inside the joint limits
+} AnalyticSolution;
+
+typedef struct
+{
+  char magic[4];                        // "OMRM"
+  uint32_t version;
+  uint32_t dof;
+  uint32_t size[3];                     // number of cells (x, y, z)
+  double min[3];                        // lower corner of the grid (m)
+  double resolution;                    // cell size (m)
+} ReachabilityMapHeader;
+
+/*****************************************************************************
+** Chain state : joint values of the plan links, published by the control loop
+**               after each forward kinematics (seqlock, single writer)
+**               the writer never waits, readers retry while it is writing
+*****************************************************************************/
+class ChainState
+{
+private:
+  std::atomic<uint32_t> sequence_;      // odd while writing (0 : nothing published)
+  std::atomic<double> value_[CHAIN_STATE_SIZE];
+  std::vector<Name> name_;              // set with the plan, before the readers start
+
+  ChainState(const ChainState &);
+  ChainState &operator=(const ChainState &);
+
+public:
+  ChainState():sequence_(0){}
+  ~ChainState(){}
+
+  void setName(const std::vector<Name> &name);
+  int8_t findIndex(Name name) const;    // -1 : not published
+  uint8_t getSize() const {return name_.size();}
+
+  void write(const double *value);      // getSize() values
+  bool read(double *value) const;       // false : nothing published yet
+};
+
+/*****************************************************************************
+** IK workspace : flat copy of the active joint chain (world child -> tool)
+**                reused by the solvers instead of copying the Manipulator
+*****************************************************************************/
+class IKWorkspace
+{
+private:
+  int8_t dof_;
+  Name tool_name_;
+  std::vector<Name> joint_name_;
+  std::vector<int8_t> state_index_;     // index on the chain state (empty : read the manipulator)
+
+  // index 0 ~ dof-1 : active joints, index dof : tool
+  std::vector<Eigen::Vector3d> axis_;
+  std::vector<AxisType> axis_type_;
+  std::vector<Eigen::Vector3d> relative_position_;
+  std::vector<Eigen::Vector3d> position_;
+  std::vector<Eigen::Matrix3d> orientation_;
+  std::vector<double> joint_value_;
+  std::vector<double> joint_max_;
+  std::vector<double> joint_min_;
+
+  Eigen::Vector3d world_position_;
+  Eigen::Matrix3d world_orientation_;
+
+  double start_time_;                   // us
+  double deadline_;                     // us on CLOCK_MONOTONIC (0 : no deadline)
+
+public:
+  IKWorkspace():dof_(0),start_time_(0.0),deadline_(0.0){}
+  ~IKWorkspace(){}
+
+  // state : joint values published by the control loop, read instead of the manipulator when given
+  bool build(Manipulator *manipulator, Name tool_name, const std::map<Name, JointLimit> *joint_limit = NULL, const ChainState *state = NULL);
+  void loadJointValue(Manipulator *manipulator, const ChainState *state = NULL);
+  bool load(Manipulator *manipulator, Name tool_name, const std::map<Name, JointLimit> *joint_limit = NULL, const ChainState *state = NULL);
+  void clear(){dof_ = 0;}
+  void forward();
+
+  template <int DOF>
+  void forwardWithJacobian(Eigen::Matrix<double, 6, DOF> *jacobian);
+
+  int8_t getDOF(){return dof_;}
+  Name getJointName(int8_t index){return joint_name_.at(index);}
+  Eigen::Vector3d getAxis(int8_t index){return axis_.at(index);}
+  Eigen::Vector3d getRelativePosition(int8_t index){return relative_position_.at(index);}
+  Eigen::Vector3d getToolPosition(){return position_.at(dof_);}
+  Eigen::Matrix3d getToolOrientation(){return orientation_.at(dof_);}
+  const Eigen::Vector3d &getJointPosition(int8_t index){return position_[index];}       // after forward
+  const Eigen::Matrix3d &getJointOrientation(int8_t index){return orientation_[index];}
+  Eigen::Vector3d getWorldPosition(){return world_position_;}
+  Eigen::Matrix3d getWorldOrientation(){return world_orientation_;}
+
+  double getJointValue(int8_t index){return joint_value_.at(index);}
+  double getJointMax(int8_t index){return joint_max_.at(index);}
+  double getJointMin(int8_t index){return joint_min_.at(index);}
+  void setJointValue(int8_t index, double value){joint_value_.at(index) = value;}
+  void setAllJointValue(const std::vector<double> &joint_value);
+  void clampJointValue();
+  bool isInJointLimit();
+  void getAllJointValue(std::vector<double> *joint_value){joint_value->assign(joint_value_.begin(), joint_value_.begin() + dof_);}
+
+  // copied along with the workspace, so the multi start workers see the time limit of their solve
+  void setTimeLimit(double start_time, double deadline){start_time_ = start_time; deadline_ = deadline;}
+  double getStartTime(){return start_time_;}
+  double getDeadline(){return deadline_;}
+};
+
+/*****************************************************************************
+** FK kernel : tool position of many configurations in one call
+**             joint values in SoA layout (one array per joint)
+**             only for a yaw joint followed by pitch joints (OpenManipulator Chain)
+*****************************************************************************/
+class ChainFKKernel
+{
+private:
+  int8_t dof_;
+  Eigen::Vector3d world_position_;
+  Eigen::Matrix3d world_orientation_;
+  Eigen::Vector3d base_offset_;         // joint1 from world (before world orientation)
+  double offset_y_;                     // pitch joints keep y, so the y offsets just add up
+  std::vector<double> offset_x_;        // index 0 : joint2, ..., dof-1 : tool (on the arm plane)
+  std::vector<double> offset_z_;
+
+  void solveScalar(const double * const *joint_value, uint32_t begin, uint32_t end, double *x, double *y, double *z);
+
+public:
+  ChainFKKernel():dof_(0){}
+  ~ChainFKKernel(){}
+
+  bool build(Manipulator *manipulator, Name tool_name);
+  void solve(const double * const *joint_value, uint32_t size, double *x, double *y, double *z);
+
+  int8_t getDOF(){return dof_;}
+};
+
+/*****************************************************************************
+** Reachability map : voxel grid over the workspace, generated offline
+**                    each cell keeps a reachable flag and an IK seed
+**                    (memory-mapped file, not available on OpenCR)
+*****************************************************************************/
+class ReachabilityMap
+{
+private:
+  void *mapped_;
+  size_t mapped_size_;
+  const ReachabilityMapHeader *header_;
+  const float *cell_;                   // per cell : reachable flag, seed (dof)
+
+  ReachabilityMap(const ReachabilityMap &);
+  ReachabilityMap &operator=(const ReachabilityMap &);
+
+public:
+  ReachabilityMap():mapped_(NULL),mapped_size_(0),header_(NULL),cell_(NULL){}
+  ~ReachabilityMap(){unload();}
+
+  static bool save(STRING file_name, const ReachabilityMapHeader &header, const std::vector<float> &cell);
+  bool load(STRING file_name);
+  void unload();
+
+  bool isLoaded(){return (header_ != NULL);}
+  int8_t getDOF(){return (header_ != NULL) ? header_->dof : 0;}
+  double getResolution(){return (header_ != NULL) ? header_->resolution : 0.0;}
+  const float *findSeed(Eigen::Vector3d position); // NULL : not reachable
+};
+
+/*****************************************************************************
+** Workspace envelope : positions the tool reaches from joint2 with the joint limits
+**                      polar grid (distance, angle) on the arm plane with joint2 at 0,
+**                      the pitch of joint2 turns it, the yaw of joint1 is checked apart
+**                      cells are inflated by the sampling error (never rejects a reachable goal)
+**                      only for a yaw joint followed by pitch joints (OpenManipulator Chain)
+*****************************************************************************/
+class WorkspaceEnvelope
+{
+private:
+  int8_t dof_;
+  double joint2_min_;
+  double joint2_max_;
+  double max_reach_;                    // tool from joint2, links stretched
+  double distance_resolution_;          // m
+  double angle_resolution_;             // rad
+  uint32_t distance_size_;
+  uint32_t angle_size_;
+  std::vector<uint8_t> cell_;           // distance major, 1 : reachable
+
+  void mark(double distance, double angle, double radius);
+
+public:
+  WorkspaceEnvelope():dof_(0),joint2_min_(0.0),joint2_max_(0.0),max_reach_(0.0),
+                      distance_resolution_(0.002),angle_resolution_(M_PI / 180.0),distance_size_(0),angle_size_(0){}
+  ~WorkspaceEnvelope(){}
+
+  bool build(IKWorkspace *workspace, double distance_resolution = 0.002, double angle_resolution = M_PI / 180.0);
+  void clear(){dof_ = 0;}
+
+  // plane position of the tool from joint2 (r : along the yaw, z : vertical)
+  bool isReachable(double plane_r, double plane_z);
+
+  bool isBuilt(){return (dof_ > 0);}
+  double getMaxReach(){return max_reach_;}
+};
+
+#if !defined(__OPENCR__)
+/*****************************************************************************
+** IK thread pool : runs the jobs of one call on the workers and the caller
+*****************************************************************************/
+class IKThreadPool
+{
+private:
+  std::vector<std::thread> thread_;
+  std::mutex mutex_;
+  std::condition_variable job_condition_;
+  std::condition_variable done_condition_;
+  std::function<void(uint32_t)> job_;
+  uint32_t job_size_;
+  uint32_t next_job_;
+  uint32_t done_job_;
+  bool stop_;
+  std::mutex run_mutex_;                // one call at a time
+
+  void workerLoop();
+  void runNextJob(std::unique_lock<std::mutex> &lock);
+
+public:
+  IKThreadPool():job_size_(0),next_job_(0),done_job_(0),stop_(false){}
+  ~IKThreadPool(){stop();}
+
+  void start(uint8_t thread_size);
+  void stop();
+  bool run(uint32_t job_size, const std::function<void(uint32_t)> &job); // false : used by another thread (nothing run)
+
+  uint8_t getThreadSize(){return thread_.size();}
+};
+#endif
+
+/*****************************************************************************
+** IK context : scratch memory of the solves of one thread
+*****************************************************************************/
+typedef struct
+{
+  uint32_t description_version;         // workspace is rebuilt when the chain description changes
+  IKWorkspace workspace;
+  IKResult result;                      // record of the last solve
+  double deadline;                      // us on CLOCK_MONOTONIC (0 : no deadline)
+
+  // multi start
+  std::vector<std::vector<double> > start_seed;
+  std::vector<IKWorkspace> start_workspace;
+  std::vector<IKResult> start_result;
+
+  // forward kinematics of the manipulators other than the one of the plan
+  std::vector<Eigen::Vector3d> fk_position;
+  std::vector<Eigen::Matrix3d> fk_orientation;
+} IKContext;
+
+/*****************************************************************************
+** Chain : re-entrant, every thread solves on its own IK context
+**         the joint limits, the options, the reachability map and the plan are set before the threads start,
+**         the joint values of the plan manipulator are read from the chain state published by its FK pass
+*****************************************************************************/
 class Chain : public ROBOTIS_MANIPULATOR::Kinematics
 {
 private:
-  STRING inverse_solver_option_;
+  uint32_t id_;                         // key of the IK contexts of this chain
+  std::atomic<uint8_t> inverse_solver_; // InverseSolverType
+  std::map<Name, JointLimit> joint_limit_;
+  std::atomic<uint32_t> description_version_;
+  ReachabilityMap reachability_map_;
+  WorkspaceEnvelope workspace_envelope_;
+  Name envelope_tool_name_;
+  std::atomic<uint8_t> envelope_state_; // EnvelopeState
+#if !defined(__OPENCR__)
+  IKThreadPool thread_pool_;
+#else
+  IKContext context_;
+#endif
+
+  IKOptions ik_options_;
+
+  // forward kinematics plan (parent link always comes before its children)
+  // the manipulator of the plan is updated from the first changed joint downstream only,
+  // its component poses must not be written by anything else
+  std::vector<ForwardKinematicsLink> fk_link_;
+  std::vector<Eigen::Vector3d> fk_position_;
+  std::vector<Eigen::Matrix3d> fk_orientation_;
+  std::vector<uint8_t> fk_dirty_;
+  Manipulator *fk_manipulator_;
+  bool fk_cache_valid_;                 // false until the first pass on the plan manipulator
+  std::atomic_flag fk_busy_;            // set while a thread updates the cache
+  Eigen::Vector3d fk_world_position_;
+  Eigen::Matrix3d fk_world_orientation_;
+  ChainState state_;
+
+  IKContext *getContext();
+  void initContext(IKContext *context);
+  bool loadWorkspace(IKContext *context, Manipulator *manipulator, Name tool_name);
+  const ChainState *getState(Manipulator *manipulator){return (manipulator == fk_manipulator_) ? &state_ : NULL;}
+  void forwardSolverUsingCache(Manipulator *manipulator);
+  void forwardSolverUsingContext(Manipulator *manipulator, IKContext *context);
+  bool updateWorkspaceEnvelope(Manipulator *manipulator, STRING *reason);
+
+  typedef bool (Chain::*InverseSolver)(IKWorkspace *workspace, Pose target_pose, IKResult *result);
+  // fail_log : logged on a failure (NULL : no log), after "[solver_name]" when given
+  bool solveInverse(Manipulator *manipulator, Name tool_name, Pose target_pose, std::vector<double>* goal_joint_value, InverseSolver solver,
+                    const char *fail_log, const char *solver_name = NULL);
+  bool isTimeOut(IKWorkspace *workspace);
+
+  // solvers working on the seeded workspace (no log, no manipulator access)
+  bool solveInverseOnWorkspace(IKWorkspace *workspace, Pose target_pose, IKResult *result);
+  bool solveInverseFromSeeds(IKWorkspace *workspace, Pose target_pose, IKResult *result);
+  bool solveInverseUsingReachabilityMap(IKWorkspace *workspace, Pose target_pose, IKResult *result);
+  bool solveInverseMultiStart(IKWorkspace *workspace, Pose target_pose, IKResult *result);
+  bool mirrorElbow(IKWorkspace *workspace, std::vector<double> *joint_value);
+  bool isClampJointLimit(){return (ik_options_.clamp_joint_limit || ik_options_.multi_start);}
+  bool solveJacobianInverse(IKWorkspace *workspace, Pose target_pose, IKResult *result);
+  bool solveSRInverse(IKWorkspace *workspace, Pose target_pose, IKResult *result);
+  bool solvePositionOnlySRInverse(IKWorkspace *workspace, Pose target_pose, IKResult *result);
+  bool solveChainCustomInverse(IKWorkspace *workspace, Pose target_pose, IKResult *result);
+  bool solveAnalyticInverse(IKWorkspace *workspace, Pose target_pose, IKResult *result);
+  bool analyticInverseSolutions(IKWorkspace *workspace, Pose target_pose, AnalyticSolution *solution);
+
+  template <int DOF>
+  bool jacobianInverseSolver(IKWorkspace *workspace, Pose target_pose, IKResult *result);
+  template <int DOF>
+  bool srInverseSolver(IKWorkspace *workspace, Pose target_pose, Vector6d weight, IKResult *result);
+  template <int DOF>
+  void resolvedRateSolver(IKWorkspace *workspace, Vector6d twist, double time_step);
+  template <int DOF>
+  void manipulabilitySolver(IKWorkspace *workspace, double *manipulability, double *min_singular_value);
+
+protected:
+  // publishes the joint values of the plan manipulator (for the FK passes not using the plan)
+  void publishState(Manipulator *manipulator);
+
 public:
-  Chain():inverse_solver_option_("chain_custom_inverse_kinematics"){}
+  Chain();
   virtual ~Chain(){}
 
   virtual void setOption(const void *arg);
@@ -46,12 +489,120 @@ public:
   virtual void forwardKinematics(Manipulator *manipulator);
   virtual bool inverseKinematics(Manipulator *manipulator, Name tool_name, Pose target_pose, std::vector<double>* goal_joint_value);
 
+  template <int DOF>
+  void jacobian(Manipulator *manipulator, Name tool_name, Eigen::Matrix<double, 6, DOF> *jacobian);
+  template <int DOF>
+  bool forwardKinematicsWithJacobian(Manipulator *manipulator, Name tool_name, Pose *tool_pose, Eigen::Matrix<double, 6, DOF> *jacobian);
+  Vector6d poseDifference(Pose target_pose, Eigen::Vector3d present_position, Eigen::Matrix3d present_orientation);
+  // manipulability index sqrt(det(J^T*J)) and the smallest singular value of the jacobian (both 0 on a singularity)
+  // joint_value : configuration to check (NULL : present joint values)
+  bool manipulability(Manipulator *manipulator, Name tool_name, double *manipulability, double *min_singular_value, const std::vector<double> *joint_value = NULL);
+
+  void buildForwardKinematicsPlan(Manipulator *manipulator);
+  void forwardSolverUsingPlan(Manipulator *manipulator);
   void forwardSolverUsingChainRule(Manipulator *manipulator, Name component_name);
   bool inverseSolverUsingJacobian(Manipulator *manipulator, Name tool_name, Pose target_pose, std::vector<double>* goal_joint_value);
   bool inverseSolverUsingSRJacobian(Manipulator *manipulator, Name tool_name, Pose target_pose, std::vector<double>* goal_joint_value);
   bool inverseSolverUsingPositionOnlySRJacobian(Manipulator *manipulator, Name tool_name, Pose target_pose, std::vector<double>* goal_joint_value);
   bool chainCustomInverseKinematics(Manipulator *manipulator, Name tool_name, Pose target_pose, std::vector<double>* goal_joint_value);
+  bool analyticInverseKinematics(Manipulator *manipulator, Name tool_name, Pose target_pose, std::vector<double>* goal_joint_value);
+  bool solveAnalyticInverseKinematics(Manipulator *manipulator, Name tool_name, Pose target_pose, std::vector<std::vector<double> >* solutions);
+  // one step of streaming control : twist (linear, angular velocity on the world frame) -> goal_joint_value
+  // goal_joint_value : goal of the previous tick, integrated in place (empty : start from the present joint values)
+  bool resolvedRate(Manipulator *manipulator, Name tool_name, Vector6d twist, double time_step, std::vector<double>* goal_joint_value);
+  bool inverseKinematicsBatch(Manipulator *manipulator, Name tool_name, const std::vector<Pose> &target_pose, const std::vector<std::vector<double> > &seed, std::vector<IKResult> *result);
+  // active joint values (world child -> tool) of the last FK pass, safe from any thread
+  bool getPresentJointValue(Manipulator *manipulator, Name tool_name, std::vector<double> *joint_value);
+
+  bool generateReachabilityMap(Manipulator *manipulator, Name tool_name, double resolution, STRING file_name);
+  bool loadReachabilityMap(STRING file_name);
+
+  // task space goal check before the trajectory : reach, joint limit envelope, distance from the joint1 axis
+  // and the orientation of the inverse solver in use (analytic solutions), reason : why it is rejected
+  // a new joint limit marks the envelope stale, the next check rebuilds it (goals are rejected until it is built again)
+  bool buildWorkspaceEnvelope(Manipulator *manipulator, Name tool_name);
+  // keep : present tool pose of the last FK pass for the position or orientation only goals
+  bool checkTaskSpaceGoal(Manipulator *manipulator, Name tool_name, Pose target_pose, STRING *reason = NULL,
+                          TaskGoalKeep keep = TASK_GOAL_KEEP_NONE);
+
+  void setIKOptions(IKOptions options);
+  IKOptions getIKOptions();
+  IKResult getIKResult();               // last solve of the calling thread
+  void setDeadline(double deadline);    // solves of the calling thread
+
+  void setJointLimit(Name joint_name, double max_limit, double min_limit);
+  bool checkJointLimit(Name joint_name, double value);
+
+};
+
+/*****************************************************************************
+** OpenManipulator Chain with its description baked in at compile time
+**   link : unit axis of the joint and offset from the parent (mm)
+**   the zero offsets and the axis products are folded by the compiler
+*****************************************************************************/
+template <AxisType AXIS, int X, int Y, int Z>
+struct StaticLink
+{
+  static constexpr AxisType axis(){return AXIS;}
+  static constexpr double x(){return X * 0.001;}
+  static constexpr double y(){return Y * 0.001;}
+  static constexpr double z(){return Z * 0.001;}
+};
+
+typedef StaticLink<AXIS_Z, 12, 0, 17>     OpenManipulatorJoint1;
+typedef StaticLink<AXIS_Y, 0, 0, 58>      OpenManipulatorJoint2;
+typedef StaticLink<AXIS_Y, 24, 0, 128>    OpenManipulatorJoint3;
+typedef StaticLink<AXIS_Y, 124, 0, 0>     OpenManipulatorJoint4;
+typedef StaticLink<AXIS_NONE, 130, 0, 0>  OpenManipulatorGripper;
+
+template <typename LINK>
+inline void staticLinkForward(const Eigen::Vector3d &parent_position, const Eigen::Matrix3d &parent_rotation, double joint_value,
+                              Eigen::Vector3d *position, Eigen::Matrix3d *rotation)
+{
+  *position = parent_position;
+  if (LINK::x() != 0.0) *position += LINK::x() * parent_rotation.col(0);
+  if (LINK::y() != 0.0) *position += LINK::y() * parent_rotation.col(1);
+  if (LINK::z() != 0.0) *position += LINK::z() * parent_rotation.col(2);
+
+  if (LINK::axis() == AXIS_NONE)
+  {
+    *rotation = parent_rotation;
+    return;
+  }
+
+  const double sin_value = sin(joint_value);
+  const double cos_value = cos(joint_value);
+  const int8_t axis = LINK::axis() - AXIS_X;            // 0 : x, 1 : y, 2 : z
+  const int8_t first = (axis + 1) % 3;                  // columns turned by the joint
+  const int8_t second = (axis + 2) % 3;
+
+  rotation->col(axis) = parent_rotation.col(axis);
+  rotation->col(first) = cos_value * parent_rotation.col(first) + sin_value * parent_rotation.col(second);
+  rotation->col(second) = cos_value * parent_rotation.col(second) - sin_value * parent_rotation.col(first);
+}
+
+class OpenManipulatorChainStatic : public Chain
+{
+private:
+  enum {DESCRIPTION_UNCHECKED = 0, DESCRIPTION_MATCHED, DESCRIPTION_DIFFERENT};
+  std::atomic<uint8_t> description_state_;  // stored once the check is over (callers on any thread)
+  Name link_name_[5];
+
+  bool checkDescription(Manipulator *manipulator);
+  bool matchDescription(Manipulator *manipulator);
+
+public:
+  OpenManipulatorChainStatic();
+  virtual ~OpenManipulatorChainStatic(){}
+
+  // same as Chain, falls back to it when the manipulator is not the OpenManipulator Chain
+  virtual MatrixXd jacobian(Manipulator *manipulator, Name tool_name);
+  virtual void forwardKinematics(Manipulator *manipulator);
 
+  // index 0 ~ 3 : joint1 ~ joint4, 4 : gripper (from world)
+  static void forward(const double joint_value[4], Eigen::Vector3d position[5], Eigen::Matrix3d orientation[5]);
+  static void forwardWithJacobian(const double joint_value[4], Eigen::Vector3d position[5], Eigen::Matrix3d orientation[5],
+                                  Eigen::Matrix<double, 6, 4> *jacobian);
 };
 
 } // namespace KINEMATICS
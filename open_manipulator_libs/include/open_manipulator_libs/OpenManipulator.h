@@ -21,9 +21,21 @@
 
 #include "Dynamixel.h"
 #include "Drawing.h"
+#include "Collision.h"
+#include "Dynamics.h"
 #include "Kinematics.h"
 
 #define NUM_OF_JOINT 4
+
+// joint limits (rad), given to the manipulator and to the kinematics
+#define JOINT1_MAX_LIMIT M_PI
+#define JOINT1_MIN_LIMIT (-M_PI)
+#define JOINT2_MAX_LIMIT M_PI_2
+#define JOINT2_MIN_LIMIT (-2.05)
+#define JOINT3_MAX_LIMIT 1.53
+#define JOINT3_MIN_LIMIT (-M_PI_2)
+#define JOINT4_MAX_LIMIT 2.0
+#define JOINT4_MIN_LIMIT (-1.8)
 #define DXL_SIZE 5
 
 #define DRAWING_LINE "drawing_line"
@@ -40,13 +52,36 @@
 #define Y_AXIS RM_MATH::makeVector3(0.0, 1.0, 0.0)
 #define Z_AXIS RM_MATH::makeVector3(0.0, 0.0, 1.0)
 
+typedef struct
+{
+  int8_t tool_index;                    // index on the tools of the singularity monitor
+  KINEMATICS::Vector6d twist;
+  double timeout;                       // s, stop when no new velocity comes in
+} TaskVelocityCommand;
+
+typedef struct
+{
+  std::vector<double> manipulability;   // index : order of the tools
+  std::vector<double> min_singular_value;
+} ManipulabilityValue;
+
+typedef struct
+{
+  std::vector<uint8_t> actuator_id;     // order of the ids on the bus
+  std::vector<uint8_t> available;       // 0 : no monitoring items on the read of this id
+  std::vector<double> voltage;          // V
+  std::vector<double> temperature;      // degC
+  std::vector<uint8_t> hardware_error;  // Hardware_Error_Status
+} ActuatorMonitorValue;
+
 
 class OPEN_MANIPULATOR : public ROBOTIS_MANIPULATOR::RobotisManipulator
 {
 private:
-  ROBOTIS_MANIPULATOR::Kinematics *kinematics_;
+  KINEMATICS::Chain *kinematics_;
   ROBOTIS_MANIPULATOR::JointActuator *actuator_;
   ROBOTIS_MANIPULATOR::ToolActuator *tool_;
+  DYNAMIXEL::DynamixelBus *dxl_bus_;   // one port : one sync read and one sync write per cycle
 
   DRAWING::Line line_;
   DRAWING::Circle circle_;
@@ -55,12 +90,71 @@ private:
 
   bool platform_;
   std::vector<uint8_t> jointDxlId;
+
+  // streaming control (resolved rate), runs while no trajectory is moving
+  // the command comes in from another thread as a whole, the control thread works on its copy
+  DYNAMIXEL::ExchangeBuffer<TaskVelocityCommand> task_velocity_buffer_;
+  TaskVelocityCommand task_velocity_;   // control thread only
+  double task_velocity_time_;           // s, when the last velocity came in
+  double task_velocity_previous_time_;  // s, last tick
+  std::vector<double> task_velocity_goal_;
+
+  std::vector<WayPoint> getJointGoalValueFromTaskVelocity(double present_time);
+
+  // singularity monitor, updated every control cycle (index : order of the tools)
+  // published by the control thread, read by one other thread (getManipulability)
+  std::vector<Name> tool_name_;
+  DYNAMIXEL::ExchangeBuffer<ManipulabilityValue> manipulability_buffer_;
+
+  // monitoring items of the last read, copied by the control thread, read by one other thread (getActuatorMonitor)
+  DYNAMIXEL::ExchangeBuffer<ActuatorMonitorValue> actuator_monitor_buffer_;
+
+  // feed-forward torque of the joint goals (inverse dynamics, when the link inertials are loaded)
+  DYNAMICS::ChainDynamics dynamics_;
+  std::vector<double> goal_joint_value_;
+  std::vector<double> goal_joint_velocity_;
+  std::vector<double> goal_joint_acceleration_;
+  std::vector<double> goal_joint_torque_;
+
+  // gravity compensation mode : the joint goals go out every cycle, the last one is held when nothing moves
+  bool gravity_compensation_mode_;
+  std::vector<WayPoint> hold_goal_value_;
+
+  // self collision and base plane check of the joint goals (bounding capsules of the links)
+  COLLISION::ChainCollision collision_;
+
+  bool checkJointControlMode(STRING joint_mode);
+  void setGoalJointEffort(std::vector<WayPoint> *goal_value);
+  std::vector<WayPoint> getHoldGoalValue();
  public:
   OPEN_MANIPULATOR();
   virtual ~OPEN_MANIPULATOR();
 
-  void initManipulator(bool using_platform, STRING usb_port = "/dev/ttyUSB0", STRING baud_rate = "1000000");
+  // joint_mode : set on the actuators before their torque is on ("gravity_compensation_mode" needs dynamics_description)
+  void initManipulator(bool using_platform, STRING usb_port = "/dev/ttyUSB0", STRING baud_rate = "1000000", STRING kinematics = "chain",
+                       STRING joint_mode = "position_mode", const URDF::Model *dynamics_description = NULL);
   void openManipulatorProcess(double present_time);
+  bool loadReachabilityMap(STRING file_name, double resolution = 0.02);
+  bool loadDynamics(const URDF::Model &description); // link inertials
+  bool isDynamicsLoaded();
+  bool loadCollision(const URDF::Model &description); // collision geometry of the links (mesh files on the file system)
+  bool isCollisionFree(std::vector<double> goal_joint_value, STRING *reason = NULL); // path from the present joint values
+  bool getPresentJointValue(std::vector<double> *joint_value); // last control cycle, any thread
+  // task space goal in the workspace of the joint limits (same goals as taskTrajectoryMove)
+  bool checkTaskSpaceGoal(Name tool_name, Pose target_pose, STRING *reason = NULL);
+  bool checkTaskSpaceGoal(Name tool_name, Eigen::Vector3d target_position, STRING *reason = NULL);
+  bool checkTaskSpaceGoal(Name tool_name, Eigen::Matrix3d target_orientation, STRING *reason = NULL);
+  bool setJointControlMode(STRING joint_mode); // "position_mode", "gravity_compensation_mode" (after loadDynamics), torque off and on again
+  STRING getJointControlMode();
+  bool setBusThread(bool using_thread); // Dynamixel transactions on their own thread (present values one cycle behind)
+  // input voltage (V), temperature (degC) and hardware error status of the last control cycle (X-series), one reader thread
+  bool getActuatorMonitor(uint8_t actuator_id, double *voltage, double *temperature, uint8_t *hardware_error);
+  std::vector<uint8_t> getActuatorId(); // ids of the actuator monitor
+  void setKinematicsDeadline(double deadline);
+  void setIKMultiStart(bool using_multi_start); // off by default : up to three solves per inverse kinematics
+  void setTaskVelocity(Name tool_name, KINEMATICS::Vector6d twist, double timeout = 0.1);
+  bool getManipulability(Name tool_name, double *manipulability, double *min_singular_value); // last control cycle, one reader thread
+  bool getManipulability(Name tool_name, std::vector<double> joint_value, double *manipulability, double *min_singular_value);
   bool getPlatformFlag();
 };
 
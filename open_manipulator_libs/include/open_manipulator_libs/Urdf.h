@@ -0,0 +1,99 @@
+﻿/*******************************************************************************
+* Copyright 2018 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Authors: Darby Lim, Hye-Jong KIM, Ryan Shim, Yong-Ho Na */
+
+#ifndef URDF_H_
+#define URDF_H_
+
+#if defined(__OPENCR__)
+  #include <RobotisManipulator.h>
+#else
+  #include <robotis_manipulator/robotis_manipulator.h>
+#endif
+
+using namespace Eigen;
+using namespace ROBOTIS_MANIPULATOR;
+
+namespace URDF
+{
+
+typedef struct
+{
+  double mass;
+  Eigen::Vector3d origin;               // center of mass on the link frame
+  Eigen::Matrix3d rotation;             // inertia frame on the link frame
+  Eigen::Matrix3d inertia;
+} Inertial;
+
+typedef struct
+{
+  STRING type;                          // "mesh", "box", "cylinder", "sphere"
+  STRING file_name;                     // mesh, path on the file system
+  Eigen::Vector3d scale;                // mesh
+  Eigen::Vector3d size;                 // box
+  double radius;                        // cylinder, sphere
+  double length;                        // cylinder (along z)
+  Eigen::Vector3d origin;               // geometry frame on the link frame
+  Eigen::Matrix3d rotation;
+} Geometry;
+
+typedef struct
+{
+  bool has_inertial;
+  Inertial inertial;
+  std::vector<Geometry> collision;
+} Link;
+
+typedef struct
+{
+  Name name;
+  STRING type;                          // "revolute", "prismatic", "fixed", ...
+  Name parent;                          // parent link
+  Name child;                           // child link
+  Eigen::Vector3d origin;               // child link frame on the parent link frame (joint value 0)
+  Eigen::Matrix3d rotation;
+} Joint;
+
+/*****************************************************************************
+** Robot description : links and joints of a URDF, filled by the caller
+**                     (urdf::Model on ROS), read by the dynamics and the collision
+*****************************************************************************/
+class Model
+{
+private:
+  std::map<Name, Link> link_;
+  std::map<Name, Joint> joint_of_child_;  // key : child link
+
+public:
+  Model(){}
+  ~Model(){}
+
+  void clear();
+  void addLink(Name link_name, const Link &link);
+  void addJoint(const Joint &joint);
+
+  const std::map<Name, Link> &getLink() const {return link_;}
+  const Joint *findJoint(Name joint_name) const;
+
+  // link frame on the frame of the first of the active joints above it (false : fixed to the root link, frame on the root)
+  bool findCarryingJoint(Name link_name, const std::vector<Name> &active_joint,
+                         Name *joint_name, Eigen::Vector3d *position, Eigen::Matrix3d *rotation) const;
+};
+
+} // namespace URDF
+
+#endif // URDF_H_
@@ -0,0 +1,507 @@
+﻿/*******************************************************************************
+* Copyright 2018 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Authors: Darby Lim, Hye-Jong KIM, Ryan Shim, Yong-Ho Na */
+
+#include "../include/open_manipulator_libs/Collision.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+
+#if !defined(__OPENCR__)
+  #include <cstring>
+  #include <fstream>
+  #include <sstream>
+#endif
+
+using namespace ROBOTIS_MANIPULATOR;
+using namespace COLLISION;
+
+//-------------------- Geometry --------------------//
+
+namespace
+{
+// squared distance of the segments p1-q1 and p2-q2 (closest points, Ericson)
+double segmentDistanceSquared(const Eigen::Vector3d &p1, const Eigen::Vector3d &q1,
+                              const Eigen::Vector3d &p2, const Eigen::Vector3d &q2)
+{
+  const Eigen::Vector3d d1 = q1 - p1;
+  const Eigen::Vector3d d2 = q2 - p2;
+  const Eigen::Vector3d r = p1 - p2;
+  const double a = d1.dot(d1);
+  const double e = d2.dot(d2);
+  const double f = d2.dot(r);
+  const double epsilon = 1E-12;
+  double s, t;
+
+  if (a <= epsilon && e <= epsilon)
+    return r.dot(r);
+
+  if (a <= epsilon)
+  {
+    s = 0.0;
+    t = std::min(std::max(f / e, 0.0), 1.0);
+  }
+  else
+  {
+    const double c = d1.dot(r);
+    if (e <= epsilon)
+    {
+      t = 0.0;
+      s = std::min(std::max(-c / a, 0.0), 1.0);
+    }
+    else
+    {
+      const double b = d1.dot(d2);
+      const double denominator = a * e - b * b;
+      s = (denominator > epsilon) ? std::min(std::max((b * f - c * e) / denominator, 0.0), 1.0) : 0.0;
+      t = (b * s + f) / e;
+      if (t < 0.0)
+      {
+        t = 0.0;
+        s = std::min(std::max(-c / a, 0.0), 1.0);
+      }
+      else if (t > 1.0)
+      {
+        t = 1.0;
+        s = std::min(std::max((b - c) / a, 0.0), 1.0);
+      }
+    }
+  }
+  return (p1 + d1 * s - p2 - d2 * t).squaredNorm();
+}
+
+// capsule around the points along the axis through the center
+double fitCapsuleOnAxis(const std::vector<Eigen::Vector3d> &point, const Eigen::Vector3d &center, const Eigen::Vector3d &axis,
+                        Eigen::Vector3d *begin, Eigen::Vector3d *end, double *radius)
+{
+  // radius : farthest from the axis, then the segment as short as the end caps allow
+  *radius = 0.0;
+  for (uint32_t index = 0; index < point.size(); index++)
+  {
+    Eigen::Vector3d offset = point.at(index) - center;
+    *radius = std::max(*radius, (offset - offset.dot(axis) * axis).norm());
+  }
+
+  double lower = INFINITY, upper = -INFINITY;
+  for (uint32_t index = 0; index < point.size(); index++)
+  {
+    Eigen::Vector3d offset = point.at(index) - center;
+    double along = offset.dot(axis);
+    double across = (offset - along * axis).squaredNorm();
+    double cap = sqrt(std::max(*radius * *radius - across, 0.0));
+    lower = std::min(lower, along + cap);
+    upper = std::max(upper, along - cap);
+  }
+  if (lower > upper)
+    lower = upper = (lower + upper) / 2.0;
+
+  *begin = center + lower * axis;
+  *end = center + upper * axis;
+  return M_PI * *radius * *radius * ((upper - lower) + 4.0 / 3.0 * *radius); // volume
+}
+
+// smallest of the capsules along the principal axes of the points
+void fitCapsule(const std::vector<Eigen::Vector3d> &point, Eigen::Vector3d *begin, Eigen::Vector3d *end, double *radius)
+{
+  Eigen::Vector3d center = Eigen::Vector3d::Zero();
+  for (uint32_t index = 0; index < point.size(); index++)
+    center += point.at(index);
+  center /= point.size();
+
+  Eigen::Matrix3d covariance = Eigen::Matrix3d::Zero();
+  for (uint32_t index = 0; index < point.size(); index++)
+    covariance += (point.at(index) - center) * (point.at(index) - center).transpose();
+  Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eigen_solver(covariance);
+
+  double smallest_volume = INFINITY;
+  for (uint8_t col = 0; col < 3; col++)
+  {
+    Eigen::Vector3d axis_begin, axis_end;
+    double axis_radius;
+    double volume = fitCapsuleOnAxis(point, center, eigen_solver.eigenvectors().col(col), &axis_begin, &axis_end, &axis_radius);
+    if (volume < smallest_volume)
+    {
+      smallest_volume = volume;
+      *begin = axis_begin;
+      *end = axis_end;
+      *radius = axis_radius;
+    }
+  }
+}
+
+#if !defined(__OPENCR__)
+bool readStl(STRING file_name, std::vector<Eigen::Vector3d> *vertex)
+{
+  std::ifstream file(file_name.c_str(), std::ios::binary);
+  if (file.is_open() == false)
+    return false;
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  const STRING data = buffer.str();
+
+  // binary : 80 byte header, triangle count, 50 byte triangles (normal, 3 vertices, attribute)
+  if (data.size() >= 84)
+  {
+    uint32_t triangle;
+    memcpy(&triangle, data.data() + 80, sizeof(triangle));
+    if (data.size() == 84 + (size_t)triangle * 50)
+    {
+      vertex->reserve(vertex->size() + triangle * 3);
+      for (uint32_t index = 0; index < triangle; index++)
+      {
+        for (uint8_t num = 0; num < 3; num++)
+        {
+          float value[3];
+          memcpy(value, data.data() + 84 + index * 50 + 12 + num * 12, sizeof(value));
+          vertex->push_back(Eigen::Vector3d(value[0], value[1], value[2]));
+        }
+      }
+      return true;
+    }
+  }
+
+  // ascii : "vertex x y z"
+  std::istringstream text(data);
+  STRING word;
+  while (text >> word)
+  {
+    if (word != "vertex")
+      continue;
+    Eigen::Vector3d value;
+    if (!(text >> value(0) >> value(1) >> value(2)))
+      return false;
+    vertex->push_back(value);
+  }
+  return (vertex->size() > 0);
+}
+#endif
+
+// points of the geometry on the link frame (false : nothing to bound)
+bool getGeometryPoint(const URDF::Geometry &geometry, std::vector<Eigen::Vector3d> *point)
+{
+  point->clear();
+  if (geometry.type == "mesh")
+  {
+#if defined(__OPENCR__)
+    return false;
+#else
+    if (readStl(geometry.file_name, point) == false)
+    {
+      RM_LOG::ERROR("[collision]fail to read " + geometry.file_name);
+      return false;
+    }
+    for (uint32_t index = 0; index < point->size(); index++)
+      point->at(index) = point->at(index).cwiseProduct(geometry.scale);
+#endif
+  }
+  else if (geometry.type == "box")
+  {
+    for (uint8_t corner = 0; corner < 8; corner++)
+      point->push_back(Eigen::Vector3d((corner & 1) ? 0.5 : -0.5, (corner & 2) ? 0.5 : -0.5, (corner & 4) ? 0.5 : -0.5).cwiseProduct(geometry.size));
+  }
+  else if (geometry.type == "cylinder")
+  {
+    const uint8_t rim = 32;
+    for (uint8_t num = 0; num < rim; num++)
+    {
+      // polygon around the circle
+      double angle = 2.0 * M_PI * num / rim;
+      double radius = geometry.radius / cos(M_PI / rim);
+      point->push_back(Eigen::Vector3d(radius * cos(angle), radius * sin(angle), geometry.length / 2.0));
+      point->push_back(Eigen::Vector3d(radius * cos(angle), radius * sin(angle), -geometry.length / 2.0));
+    }
+  }
+  else
+    return false;
+
+  for (uint32_t index = 0; index < point->size(); index++)
+    point->at(index) = geometry.rotation * point->at(index) + geometry.origin;
+  return (point->size() > 0);
+}
+} // namespace
+
+//-------------------- Chain Collision --------------------//
+
+static std::atomic<uint32_t> collision_count(0);
+
+ChainCollision::ChainCollision()
+  :id_(collision_count++),
+   version_(0),
+   margin_(0.005),
+   plane_height_(0.0)
+{
+#if defined(__OPENCR__)
+  context_.version = 0;
+#endif
+}
+
+CollisionContext *ChainCollision::getContext()
+{
+#if defined(__OPENCR__)
+  CollisionContext *context = &context_;
+#else
+  // one per thread and chain collision, kept until the thread exits
+  static thread_local std::map<uint32_t, CollisionContext> context_map;
+
+  std::map<uint32_t, CollisionContext>::iterator it = context_map.find(id_);
+  if (it == context_map.end())
+  {
+    it = context_map.insert(std::make_pair(id_, CollisionContext())).first;
+    it->second.version = version_.load(std::memory_order_acquire) - 1;
+  }
+  CollisionContext *context = &it->second;
+#endif
+
+  uint32_t version = version_.load(std::memory_order_acquire);
+  if (context->version != version)
+  {
+    context->workspace = workspace_;
+    context->begin.resize(capsule_.size());
+    context->end.resize(capsule_.size());
+    context->version = version;
+  }
+  return context;
+}
+
+bool ChainCollision::build(Manipulator *manipulator, Name tool_name)
+{
+  joint_name_.clear();
+  clearCapsule();
+  if (workspace_.build(manipulator, tool_name) == false)
+    return false;
+
+  for (int8_t index = 0; index < workspace_.getDOF(); index++)
+    joint_name_.push_back(workspace_.getJointName(index));
+  version_++;
+  return true;
+}
+
+void ChainCollision::clearCapsule()
+{
+  capsule_.clear();
+  updatePair();
+}
+
+bool ChainCollision::addCapsule(Name link_name, Name joint_name, Eigen::Vector3d begin, Eigen::Vector3d end, double radius)
+{
+  Capsule capsule;
+  capsule.link = link_name;
+  capsule.body = -1;
+  capsule.begin = begin;
+  capsule.end = end;
+  capsule.radius = radius;
+
+  if (joint_name != "")
+  {
+    std::vector<Name>::iterator it = std::find(joint_name_.begin(), joint_name_.end(), joint_name);
+    if (it == joint_name_.end() || radius < 0.0)
+    {
+      RM_LOG::ERROR("[collision]wrong capsule of " + link_name);
+      return false;
+    }
+    capsule.body = it - joint_name_.begin();
+  }
+
+  capsule_.push_back(capsule);
+  updatePair();
+  return true;
+}
+
+bool ChainCollision::loadDescription(const URDF::Model &model)
+{
+  if (joint_name_.size() == 0)
+  {
+    RM_LOG::ERROR("[collision]build the chain before loading the description");
+    return false;
+  }
+
+  capsule_.clear();
+  std::vector<Eigen::Vector3d> point;
+  const std::map<Name, URDF::Link> &link = model.getLink();
+  for (std::map<Name, URDF::Link>::const_iterator it = link.begin(); it != link.end(); it++)
+  {
+    Name joint_name;
+    Eigen::Vector3d position;
+    Eigen::Matrix3d rotation;
+    if (model.findCarryingJoint(it->first, joint_name_, &joint_name, &position, &rotation) == false)
+      joint_name = "";
+
+    for (uint8_t index = 0; index < it->second.collision.size(); index++)
+    {
+      const URDF::Geometry &geometry = it->second.collision.at(index);
+      Eigen::Vector3d begin, end;
+      double radius;
+      if (geometry.type == "sphere")
+      {
+        begin = end = geometry.origin;
+        radius = geometry.radius;
+      }
+      else if (getGeometryPoint(geometry, &point))
+        fitCapsule(point, &begin, &end, &radius);
+      else
+        continue;
+
+      Capsule capsule;
+      capsule.link = it->first;
+      capsule.body = -1;
+      if (joint_name != "")
+        capsule.body = std::find(joint_name_.begin(), joint_name_.end(), joint_name) - joint_name_.begin();
+      capsule.begin = rotation * begin + position;
+      capsule.end = rotation * end + position;
+      capsule.radius = radius;
+      capsule_.push_back(capsule);
+    }
+  }
+  updatePair();
+
+  if (capsule_.size() == 0)
+  {
+    RM_LOG::ERROR("[collision]no collision geometry in the description");
+    return false;
+  }
+  return true;
+}
+
+void ChainCollision::updatePair()
+{
+  pair_.clear();
+  plane_capsule_.clear();
+  version_++;
+  if (capsule_.size() == 0 || joint_name_.size() == 0)
+    return;
+
+  // what touches at the zero pose touches by design (motor horns, brackets) and is not checked
+  CollisionContext *context = getContext();
+  const std::vector<Eigen::Vector3d> &begin = context->begin;
+  const std::vector<Eigen::Vector3d> &end = context->end;
+  placeCapsule(context, std::vector<double>(joint_name_.size(), 0.0));
+
+  for (uint8_t index = 0; index < capsule_.size(); index++)
+  {
+    for (uint8_t other = index + 1; other < capsule_.size(); other++)
+    {
+      if (std::abs(capsule_.at(index).body - capsule_.at(other).body) <= 1)
+        continue;
+
+      double distance = capsule_.at(index).radius + capsule_.at(other).radius + margin_;
+      if (segmentDistanceSquared(begin.at(index), end.at(index), begin.at(other), end.at(other)) > distance * distance)
+        pair_.push_back(std::make_pair(index, other));
+    }
+
+    double lowest = std::min(begin.at(index)(2), end.at(index)(2)) - capsule_.at(index).radius;
+    if (capsule_.at(index).body >= 0 && lowest > plane_height_ + margin_)
+      plane_capsule_.push_back(index);
+  }
+}
+
+void ChainCollision::placeCapsule(CollisionContext *context, const std::vector<double> &joint_value)
+{
+  KINEMATICS::IKWorkspace *workspace = &context->workspace;
+  workspace->setAllJointValue(joint_value);
+  workspace->forward();
+
+  for (uint8_t index = 0; index < capsule_.size(); index++)
+  {
+    const Capsule &capsule = capsule_[index];
+    if (capsule.body < 0)
+    {
+      context->begin[index] = workspace->getWorldOrientation() * capsule.begin + workspace->getWorldPosition();
+      context->end[index] = workspace->getWorldOrientation() * capsule.end + workspace->getWorldPosition();
+    }
+    else
+    {
+      const Eigen::Matrix3d &orientation = workspace->getJointOrientation(capsule.body);
+      const Eigen::Vector3d &position = workspace->getJointPosition(capsule.body);
+      context->begin[index] = orientation * capsule.begin + position;
+      context->end[index] = orientation * capsule.end + position;
+    }
+  }
+}
+
+bool ChainCollision::checkPlacedCapsule(CollisionContext *context, STRING *reason)
+{
+  const std::vector<Eigen::Vector3d> &begin = context->begin;
+  const std::vector<Eigen::Vector3d> &end = context->end;
+
+  for (uint16_t index = 0; index < pair_.size(); index++)
+  {
+    const uint8_t first = pair_[index].first;
+    const uint8_t second = pair_[index].second;
+    const double distance = capsule_[first].radius + capsule_[second].radius + margin_;
+    if (segmentDistanceSquared(begin[first], end[first], begin[second], end[second]) < distance * distance)
+    {
+      if (reason != NULL)
+        *reason = capsule_[first].link + " - " + capsule_[second].link;
+      return true;
+    }
+  }
+
+  for (uint8_t index = 0; index < plane_capsule_.size(); index++)
+  {
+    const uint8_t num = plane_capsule_[index];
+    if (std::min(begin[num](2), end[num](2)) - capsule_[num].radius < plane_height_ + margin_)
+    {
+      if (reason != NULL)
+        *reason = capsule_[num].link + " - base plane";
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ChainCollision::isCollided(const std::vector<double> &joint_value, STRING *reason)
+{
+  if (capsule_.size() == 0 || joint_value.size() < joint_name_.size())
+    return false;
+
+  CollisionContext *context = getContext();
+  placeCapsule(context, joint_value);
+  return checkPlacedCapsule(context, reason);
+}
+
+bool ChainCollision::isPathCollided(const std::vector<double> &start_value, const std::vector<double> &goal_value,
+                                    double max_step, STRING *reason)
+{
+  const uint8_t dof = joint_name_.size();
+  if (capsule_.size() == 0 || start_value.size() < dof || goal_value.size() < dof || max_step <= 0.0)
+    return false;
+
+  // the goal first, it fails most often; the start is where the arm already is
+  if (isCollided(goal_value, reason))
+    return true;
+
+  double largest_step = 0.0;
+  for (uint8_t index = 0; index < dof; index++)
+    largest_step = std::max(largest_step, std::abs(goal_value[index] - start_value[index]));
+  const uint32_t sample = ceil(largest_step / max_step);
+
+  CollisionContext *context = getContext();
+  std::vector<double> joint_value(dof);
+  for (uint32_t num = 1; num < sample; num++)
+  {
+    double ratio = (double)num / sample;
+    for (uint8_t index = 0; index < dof; index++)
+      joint_value[index] = start_value[index] + ratio * (goal_value[index] - start_value[index]);
+
+    placeCapsule(context, joint_value);
+    if (checkPlacedCapsule(context, reason))
+      return true;
+  }
+  return false;
+}
@@ -0,0 +1,222 @@
+﻿/*******************************************************************************
+* Copyright 2018 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Authors: Darby Lim, Hye-Jong KIM, Ryan Shim, Yong-Ho Na */
+
+#include "../include/open_manipulator_libs/Dynamics.h"
+
+using namespace ROBOTIS_MANIPULATOR;
+using namespace DYNAMICS;
+
+//-------------------- Chain Dynamics --------------------//
+
+ChainDynamics::ChainDynamics()
+  :dof_(0)
+{
+  gravity_ << 0.0, 0.0, -GRAVITY_ACCELERATION;
+  world_orientation_.setIdentity();
+}
+
+bool ChainDynamics::build(Manipulator *manipulator, Name tool_name)
+{
+  KINEMATICS::IKWorkspace workspace;
+  dof_ = 0;
+  if (workspace.build(manipulator, tool_name) == false)
+    return false;
+
+  const int8_t dof = workspace.getDOF();
+  joint_name_.resize(dof);
+  axis_.resize(dof);
+  axis_type_.resize(dof);
+  relative_position_.resize(dof);
+  world_orientation_ = workspace.getWorldOrientation();
+
+  for (int8_t index = 0; index < dof; index++)
+  {
+    joint_name_.at(index) = workspace.getJointName(index);
+    axis_.at(index) = workspace.getAxis(index);
+    axis_type_.at(index) = KINEMATICS::getAxisType(axis_.at(index));
+    relative_position_.at(index) = workspace.getRelativePosition(index);
+  }
+
+  zero_value_.assign(dof, 0.0);
+  rotation_.resize(dof);
+  angular_velocity_.resize(dof);
+  angular_acceleration_.resize(dof);
+  linear_acceleration_.resize(dof);
+  force_.resize(dof);
+  moment_.resize(dof);
+
+  dof_ = dof;
+  clearBody();
+  return true;
+}
+
+void ChainDynamics::clearBody()
+{
+  mass_.assign(dof_, 0.0);
+  center_of_mass_.assign(dof_, Eigen::Vector3d::Zero());
+  inertia_.assign(dof_, Eigen::Matrix3d::Zero());
+}
+
+bool ChainDynamics::addBody(Name joint_name, double mass, Eigen::Vector3d center_of_mass, Eigen::Matrix3d inertia)
+{
+  int8_t index = 0;
+  while (index < dof_ && joint_name_.at(index) != joint_name)
+    index++;
+
+  if (index == dof_ || mass <= 0.0)
+  {
+    RM_LOG::ERROR("[dynamics]wrong body of " + joint_name);
+    return false;
+  }
+
+  // parallel axis theorem : both inertias moved to the merged center of mass
+  const double total_mass = mass_.at(index) + mass;
+  const Eigen::Vector3d total_center = (mass_.at(index) * center_of_mass_.at(index) + mass * center_of_mass) / total_mass;
+  const Eigen::Vector3d offset[2] = {center_of_mass_.at(index) - total_center, center_of_mass - total_center};
+  const double offset_mass[2] = {mass_.at(index), mass};
+
+  Eigen::Matrix3d total_inertia = inertia_.at(index) + inertia;
+  for (uint8_t num = 0; num < 2; num++)
+    total_inertia += offset_mass[num] * (offset[num].squaredNorm() * Eigen::Matrix3d::Identity() - offset[num] * offset[num].transpose());
+
+  mass_.at(index) = total_mass;
+  center_of_mass_.at(index) = total_center;
+  inertia_.at(index) = total_inertia;
+  return true;
+}
+
+bool ChainDynamics::isLoaded()
+{
+  for (int8_t index = 0; index < dof_; index++)
+  {
+    if (mass_.at(index) > 0.0)
+      return true;
+  }
+  return false;
+}
+
+bool ChainDynamics::loadDescription(const URDF::Model &model)
+{
+  if (dof_ == 0)
+  {
+    RM_LOG::ERROR("[dynamics]build the chain before loading the description");
+    return false;
+  }
+
+  //////////////every link goes to the first active joint above it//////////////
+  clearBody();
+  uint8_t body_count = 0;
+  const std::map<Name, URDF::Link> &link = model.getLink();
+  for (std::map<Name, URDF::Link>::const_iterator it = link.begin(); it != link.end(); it++)
+  {
+    const URDF::Inertial &inertial = it->second.inertial;
+    if (it->second.has_inertial == false || inertial.mass <= 0.0)
+      continue;
+
+    Name joint_name;
+    Eigen::Vector3d position;
+    Eigen::Matrix3d rotation;
+    if (model.findCarryingJoint(it->first, joint_name_, &joint_name, &position, &rotation) == false)
+      continue; // fixed to the world
+
+    Eigen::Matrix3d inertia_rotation = rotation * inertial.rotation;
+    if (addBody(joint_name, inertial.mass, rotation * inertial.origin + position,
+                inertia_rotation * inertial.inertia * inertia_rotation.transpose()))
+      body_count++;
+  }
+
+  //////////////the chain of the URDF has to be the one of the manipulator//////////////
+  for (int8_t index = 0; index < dof_; index++)
+  {
+    const URDF::Joint *joint = model.findJoint(joint_name_.at(index));
+    if (joint == NULL || (joint->origin - relative_position_.at(index)).norm() > 1E-6)
+      RM_LOG::WARN("[dynamics]" + joint_name_.at(index) + " of the description is not at the position of the manipulator");
+  }
+
+  if (body_count == 0)
+  {
+    RM_LOG::ERROR("[dynamics]no link inertial for the chain in the description");
+    return false;
+  }
+  return true;
+}
+
+bool ChainDynamics::inverseDynamics(const std::vector<double> &joint_value, const std::vector<double> &joint_velocity,
+                                    const std::vector<double> &joint_acceleration, std::vector<double> *joint_torque)
+{
+  if (dof_ == 0 || joint_value.size() < (size_t)dof_ || joint_velocity.size() < (size_t)dof_ || joint_acceleration.size() < (size_t)dof_)
+    return false;
+
+  //////////////outward : motion of each joint frame (gravity as an upward acceleration of the base)//////////////
+  Eigen::Vector3d parent_angular_velocity = Eigen::Vector3d::Zero();
+  Eigen::Vector3d parent_angular_acceleration = Eigen::Vector3d::Zero();
+  Eigen::Vector3d parent_linear_acceleration = world_orientation_.transpose() * (-gravity_);
+
+  for (int8_t index = 0; index < dof_; index++)
+  {
+    const Eigen::Vector3d &position = relative_position_[index];
+    const Eigen::Vector3d &axis = axis_[index];
+    Eigen::Matrix3d &rotation = rotation_[index];
+    KINEMATICS::rotateAboutAxis(Eigen::Matrix3d::Identity(), axis_type_[index], axis,
+                                sin(joint_value[index]), cos(joint_value[index]), &rotation);
+
+    linear_acceleration_[index] = rotation.transpose() * (parent_linear_acceleration + parent_angular_acceleration.cross(position) +
+                                                          parent_angular_velocity.cross(parent_angular_velocity.cross(position)));
+
+    Eigen::Vector3d carried_angular_velocity = rotation.transpose() * parent_angular_velocity;
+    angular_velocity_[index] = carried_angular_velocity + joint_velocity[index] * axis;
+    angular_acceleration_[index] = rotation.transpose() * parent_angular_acceleration +
+                                   carried_angular_velocity.cross(joint_velocity[index] * axis) + joint_acceleration[index] * axis;
+
+    parent_angular_velocity = angular_velocity_[index];
+    parent_angular_acceleration = angular_acceleration_[index];
+    parent_linear_acceleration = linear_acceleration_[index];
+  }
+
+  //////////////inward : force and moment on each joint//////////////
+  joint_torque->resize(dof_);
+  for (int8_t index = dof_ - 1; index >= 0; index--)
+  {
+    const Eigen::Vector3d &center_of_mass = center_of_mass_[index];
+    const Eigen::Vector3d &angular_velocity = angular_velocity_[index];
+    const Eigen::Vector3d &angular_acceleration = angular_acceleration_[index];
+
+    Eigen::Vector3d center_acceleration = linear_acceleration_[index] + angular_acceleration.cross(center_of_mass) +
+                                          angular_velocity.cross(angular_velocity.cross(center_of_mass));
+    Eigen::Vector3d inertial_force = mass_[index] * center_acceleration;
+
+    force_[index] = inertial_force;
+    moment_[index] = inertia_[index] * angular_acceleration + angular_velocity.cross(inertia_[index] * angular_velocity) +
+                     center_of_mass.cross(inertial_force);
+
+    if (index < dof_ - 1)
+    {
+      Eigen::Vector3d child_force = rotation_[index + 1] * force_[index + 1];
+      force_[index] += child_force;
+      moment_[index] += rotation_[index + 1] * moment_[index + 1] + relative_position_[index + 1].cross(child_force);
+    }
+
+    (*joint_torque)[index] = axis_[index].dot(moment_[index]);
+  }
+  return true;
+}
+
+bool ChainDynamics::gravityTorque(const std::vector<double> &joint_value, std::vector<double> *joint_torque)
+{
+  return inverseDynamics(joint_value, zero_value_, zero_value_, joint_torque);
+}
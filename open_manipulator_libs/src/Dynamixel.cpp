@@ -18,8 +18,839 @@
 
 #include "../include/open_manipulator_libs/Dynamixel.h"
 
+#include <algorithm>
+
 using namespace DYNAMIXEL;
 
+//////////////////////////////////////bus
+
+DynamixelBus::DynamixelBus(STRING dxl_device_name, uint32_t dxl_baud_rate)
+  : dynamixel_workbench_(new DynamixelWorkbench), device_name_(dxl_device_name), baud_rate_(dxl_baud_rate),
+    sdk_handler_added_(false), goal_current_handler_added_(false), present_read_(&present_),
+    read_mode_(READ_SYNC), read_mode_selected_(false),
+    indirect_address_(false), monitor_handler_added_(false),
+    read_address_(ADDR_PRESENT_CURRENT_2), read_length_(LENGTH_PRESENT_VALUE_2)
+#if !defined(__OPENCR__)
+    , io_cycle_(0), io_stop_(false)
+#endif
+    , io_running_(false)
+{}
+
+DynamixelBus *DynamixelBus::getBus(STRING dxl_device_name, STRING dxl_baud_rate)
+{
+  static std::map<STRING, DynamixelBus *> bus;
+
+  uint32_t baud_rate = std::atoi(dxl_baud_rate.c_str());
+  std::map<STRING, DynamixelBus *>::iterator it = bus.find(dxl_device_name);
+  if (it != bus.end())
+  {
+    if (it->second->baud_rate_ != baud_rate)
+      RM_LOG::WARN("[dynamixel bus]" + dxl_device_name + " is already open with another baud rate");
+    return it->second;
+  }
+
+  DynamixelBus *new_bus = new DynamixelBus(dxl_device_name, baud_rate);
+  const char* log = NULL;
+  bool result = new_bus->dynamixel_workbench_->init(dxl_device_name.c_str(), baud_rate, &log);
+  if (result == false)
+  {
+    RM_LOG::ERROR(log);
+  }
+
+  bus[dxl_device_name] = new_bus;
+  return new_bus;
+}
+
+int8_t DynamixelBus::findIndex(uint8_t actuator_id)
+{
+  for (uint8_t index = 0; index < id_.size(); index++)
+  {
+    if (id_.at(index) == actuator_id)
+      return index;
+  }
+  return -1;
+}
+
+bool DynamixelBus::addId(std::vector<uint8_t> actuator_id)
+{
+  for (uint8_t num = 0; num < actuator_id.size(); num++)
+  {
+    if (findIndex(actuator_id.at(num)) >= 0)
+      continue;
+
+    id_.push_back(actuator_id.at(num));
+    present_.current.push_back(0.0);
+    present_.velocity.push_back(0.0);
+    present_.position.push_back(0.0);
+    present_.voltage.push_back(0.0);
+    present_.temperature.push_back(0.0);
+    present_.hardware_error.push_back(0);
+    present_fresh_.push_back(0);
+    goal_type_.push_back(GOAL_NONE);
+    goal_value_.resize(id_.size() * NUM_OF_GOAL_PWM_TO_GOAL_POSITION_ITEM, 0);
+    read_mode_selected_ = false;
+    indirect_address_ = false;
+  }
+  return true;
+}
+
+bool DynamixelBus::setSDKHandler()
+{
+  bool result = false;
+  const char* log = NULL;
+
+  // the handlers are added once for every actuator of the bus (their index is the order of adding)
+  if (sdk_handler_added_ || id_.size() == 0)
+    return true;
+
+  result = dynamixel_workbench_->addSyncWriteHandler(id_.at(0), "Goal_Position", &log);
+  if (result == false)
+  {
+    RM_LOG::ERROR(log);
+  }
+
+  result = dynamixel_workbench_->addSyncReadHandler(ADDR_PRESENT_CURRENT_2, LENGTH_PRESENT_VALUE_2, &log);
+  if (result == false)
+  {
+    RM_LOG::ERROR(log);
+  }
+  sdk_handler_added_ = true;
+
+  return true;
+}
+
+bool DynamixelBus::addGoalCurrentHandler()
+{
+  bool result = false;
+  const char* log = NULL;
+
+  if (goal_current_handler_added_)
+    return true;
+
+  setSDKHandler();
+  result = dynamixel_workbench_->addSyncWriteHandler(ADDR_GOAL_PWM_2, LENGTH_GOAL_PWM_TO_GOAL_POSITION_2, &log);
+  if (result == false)
+  {
+    RM_LOG::ERROR(log);
+    return false;
+  }
+  goal_current_handler_added_ = true;
+
+  return true;
+}
+
+bool DynamixelBus::setIndirectAddress()
+{
+  const char* log = NULL;
+  PortLock lock(this);
+
+  if (id_.size() == 0 || dynamixel_workbench_->getProtocolVersion() != 2.0f)
+    return false;
+
+  // address of each byte of the region, in the order of the items
+  const uint16_t item[6][2] = {{ADDR_PRESENT_CURRENT_2, LENGTH_PRESENT_CURRENT_2},
+                               {ADDR_PRESENT_VELOCITY_2, LENGTH_PRESENT_VELOCITY_2},
+                               {ADDR_PRESENT_POSITION_2, LENGTH_PRESENT_POSITION_2},
+                               {ADDR_PRESENT_INPUT_VOLTAGE_2, LENGTH_PRESENT_INPUT_VOLTAGE_2},
+                               {ADDR_PRESENT_TEMPERATURE_2, LENGTH_PRESENT_TEMPERATURE_2},
+                               {ADDR_HARDWARE_ERROR_STATUS_2, LENGTH_HARDWARE_ERROR_STATUS_2}};
+  uint8_t indirect_address[2 * LENGTH_PRESENT_MONITOR_2];
+  uint8_t num = 0;
+  for (uint8_t index = 0; index < 6; index++)
+  {
+    for (uint16_t address = item[index][0]; address < item[index][0] + item[index][1]; address++, num++)
+    {
+      indirect_address[2 * num] = address & 0xFF;
+      indirect_address[2 * num + 1] = address >> 8;
+    }
+  }
+
+  //////////////every id has the same Indirect Address table (X-series)//////////////
+  for (uint8_t index = 0; index < id_.size(); index++)
+  {
+    const ControlItem *address_item = dynamixel_workbench_->getItemInfo(id_.at(index), "Indirect_Address_1", &log);
+    const ControlItem *data_item = dynamixel_workbench_->getItemInfo(id_.at(index), "Indirect_Data_1", &log);
+    if (address_item == NULL || data_item == NULL ||
+        address_item->address != ADDR_INDIRECT_ADDRESS_1_2 || data_item->address != ADDR_INDIRECT_DATA_1_2)
+    {
+      RM_LOG::INFO("[dynamixel bus]no Indirect Address of the monitoring items on this model");
+      return false;
+    }
+  }
+
+  for (uint8_t index = 0; index < id_.size(); index++)
+  {
+    uint8_t id = id_.at(index);
+
+    // written only when it differs
+    uint32_t present_address[2 * LENGTH_PRESENT_MONITOR_2];
+    bool result = dynamixel_workbench_->readRegister(id, ADDR_INDIRECT_ADDRESS_1_2, 2 * LENGTH_PRESENT_MONITOR_2, present_address, &log);
+    bool is_same = result;
+    for (uint8_t num = 0; num < 2 * LENGTH_PRESENT_MONITOR_2 && is_same; num++)
+      is_same = (present_address[num] == indirect_address[num]);
+    if (is_same)
+      continue;
+
+    // the table is locked while the torque is on
+    int32_t torque_enable = 0;
+    dynamixel_workbench_->readRegister(id, "Torque_Enable", &torque_enable, &log);
+    if (torque_enable)
+      dynamixel_workbench_->torqueOff(id, &log);
+
+    result = dynamixel_workbench_->writeRegister(id, ADDR_INDIRECT_ADDRESS_1_2, 2 * LENGTH_PRESENT_MONITOR_2, indirect_address, &log);
+
+    if (torque_enable)
+      dynamixel_workbench_->torqueOn(id, &log);
+    if (result == false)
+    {
+      RM_LOG::ERROR(log);
+      return false;
+    }
+  }
+
+  indirect_address_ = true;
+  read_mode_selected_ = false;
+  RM_LOG::INFO("[dynamixel bus]present values and monitoring items on the Indirect Data");
+  return true;
+}
+
+bool DynamixelBus::readGoalRegister(std::vector<uint8_t> actuator_id)
+{
+  const char* log = NULL;
+  bool result = false;
+
+  const char *item_name[6] = {"Goal_PWM", "Goal_Current", "Profile_Acceleration", "Profile_Velocity", "Position_P_Gain", "Current_Limit"};
+
+  for (uint8_t num = 0; num < actuator_id.size(); num++)
+  {
+    int32_t item_value[6];
+    for (uint8_t item = 0; item < 6; item++)
+    {
+      result = dynamixel_workbench_->readRegister(actuator_id.at(num), item_name[item], &item_value[item], &log);
+      if (result == false)
+      {
+        RM_LOG::ERROR(log);
+        return false;
+      }
+    }
+
+    GoalRegister goal_register;
+    goal_register.goal_pwm = item_value[0];
+    goal_register.goal_current = item_value[1];
+    goal_register.profile_acceleration = item_value[2];
+    goal_register.profile_velocity = item_value[3];
+    goal_register.position_p_gain = item_value[4];
+    goal_register.current_limit = item_value[5];
+    goal_register_[actuator_id.at(num)] = goal_register;
+  }
+
+  return true;
+}
+
+void DynamixelBus::updateGoalRegister(uint8_t actuator_id, STRING item_name, int32_t value)
+{
+  // keep the goal current + goal position write from putting back the old value
+  std::map<uint8_t, GoalRegister>::iterator it = goal_register_.find(actuator_id);
+  if (it == goal_register_.end())
+    return;
+
+  if (item_name == "Goal_PWM")                  it->second.goal_pwm = value;
+  else if (item_name == "Goal_Current")         it->second.goal_current = value;
+  else if (item_name == "Profile_Acceleration") it->second.profile_acceleration = value;
+  else if (item_name == "Profile_Velocity")     it->second.profile_velocity = value;
+  else if (item_name == "Position_P_Gain")      it->second.position_p_gain = value;
+}
+
+const GoalRegister *DynamixelBus::getGoalRegister(uint8_t actuator_id)
+{
+  std::map<uint8_t, GoalRegister>::iterator it = goal_register_.find(actuator_id);
+  return (it == goal_register_.end()) ? NULL : &it->second;
+}
+
+bool DynamixelBus::selectReadMode()
+{
+  const char* log = NULL;
+  const uint8_t id_num = id_.size();
+
+  const char *item_name[3][2] = {{"Present_Current", "Present_Load"}, {"Present_Velocity", "Present_Speed"}, {"Present_Position", "Present_Position"}};
+  const uint16_t sync_address[3] = {ADDR_PRESENT_CURRENT_2, ADDR_PRESENT_VELOCITY_2, ADDR_PRESENT_POSITION_2};
+  const uint16_t sync_length[3] = {LENGTH_PRESENT_CURRENT_2, LENGTH_PRESENT_VELOCITY_2, LENGTH_PRESENT_POSITION_2};
+
+  read_mode_ = READ_SYNC;
+  bool sync_layout = (dynamixel_workbench_->getProtocolVersion() == 2.0f);
+
+  for (uint8_t item = 0; item < 3; item++)
+  {
+    item_address_[item].resize(id_num);
+    item_length_[item].resize(id_num);
+  }
+  raw_value_.resize(6 * id_num);
+  value_scale_.assign(id_num, ValueScale());
+
+  for (uint8_t index = 0; index < id_num; index++)
+  {
+    uint8_t id = id_.at(index);
+
+    // the conversions of the workbench as factors (velocity and current are linear in the value)
+    const ModelInfo *model_info = dynamixel_workbench_->getModelInfo(id, &log);
+    if (model_info == NULL)
+    {
+      RM_LOG::ERROR(log);
+      return false;
+    }
+    ValueScale &scale = value_scale_.at(index);
+    scale.zero_position = model_info->value_of_zero_radian_position;
+    scale.positive_radian = model_info->max_radian / (double)(model_info->value_of_max_radian_position - model_info->value_of_zero_radian_position);
+    scale.negative_radian = model_info->min_radian / (double)(model_info->value_of_min_radian_position - model_info->value_of_zero_radian_position);
+    scale.velocity = dynamixel_workbench_->convertValue2Velocity(id, 1);
+    scale.current = dynamixel_workbench_->convertValue2Current(1);
+
+    for (uint8_t item = 0; item < 3; item++)
+    {
+      const ControlItem *control_item = dynamixel_workbench_->getItemInfo(id, item_name[item][0], &log);
+      if (control_item == NULL)
+        control_item = dynamixel_workbench_->getItemInfo(id, item_name[item][1], &log);
+      if (control_item == NULL)
+      {
+        RM_LOG::ERROR("[dynamixel bus]no present value on the control table of the Dynamixel");
+        return false;
+      }
+
+      item_address_[item].at(index) = control_item->address;
+      item_length_[item].at(index) = control_item->data_length;
+      if (control_item->address != sync_address[item] || control_item->data_length != sync_length[item])
+        sync_layout = false;
+    }
+  }
+
+  //////////////models with another layout : one address range of each id//////////////
+  if (sync_layout == false)
+  {
+    bool result = dynamixel_workbench_->initBulkRead(&log);
+    for (uint8_t index = 0; index < id_num && result; index++)
+    {
+      uint16_t begin = item_address_[0].at(index), end = item_address_[0].at(index) + item_length_[0].at(index);
+      for (uint8_t item = 1; item < 3; item++)
+      {
+        begin = std::min(begin, item_address_[item].at(index));
+        end = std::max(end, (uint16_t)(item_address_[item].at(index) + item_length_[item].at(index)));
+      }
+      result = dynamixel_workbench_->addBulkReadParam(id_.at(index), begin, end - begin, &log);
+    }
+
+    if (result == false)
+    {
+      RM_LOG::ERROR(log);
+      return false;
+    }
+    read_mode_ = READ_BULK;
+    indirect_address_ = false; // present values only
+    RM_LOG::INFO("[dynamixel bus]Bulk Read of the present values");
+    return true;
+  }
+
+  //////////////same layout on every id : the present values, or the indirect data with the monitoring items//////////////
+  read_address_ = indirect_address_ ? ADDR_INDIRECT_DATA_1_2 : ADDR_PRESENT_CURRENT_2;
+  read_length_ = indirect_address_ ? LENGTH_PRESENT_MONITOR_2 : LENGTH_PRESENT_VALUE_2;
+
+  if (indirect_address_ && monitor_handler_added_ == false)
+  {
+    if (dynamixel_workbench_->addSyncReadHandler(ADDR_INDIRECT_DATA_1_2, LENGTH_PRESENT_MONITOR_2, &log) == false)
+    {
+      RM_LOG::ERROR(log);
+      indirect_address_ = false;
+      read_address_ = ADDR_PRESENT_CURRENT_2;
+      read_length_ = LENGTH_PRESENT_VALUE_2;
+    }
+    monitor_handler_added_ = indirect_address_;
+  }
+
+  return true;
+}
+
+void DynamixelBus::convertPresentValue(uint8_t index, int16_t current, int32_t velocity, int32_t position)
+{
+  const ValueScale &scale = value_scale_[index];
+  present_.current[index] = current * scale.current;
+  present_.velocity[index] = velocity * scale.velocity;
+  present_.position[index] = (position - scale.zero_position) *
+                             (position > scale.zero_position ? scale.positive_radian : scale.negative_radian);
+}
+
+void DynamixelBus::convertMonitorValue(uint8_t index, uint16_t voltage, uint8_t temperature, uint8_t hardware_error)
+{
+  present_.voltage[index] = voltage * PRESENT_INPUT_VOLTAGE_UNIT;
+  present_.temperature[index] = temperature;
+  present_.hardware_error[index] = hardware_error;
+}
+
+bool DynamixelBus::readPresentValue(const char **log)
+{
+  bool result = false;
+  const char* read_log = NULL;
+
+  if (id_.size() == 0)
+    return false;
+
+  if (read_mode_selected_ == false)
+  {
+    if (selectReadMode() == false)
+      read_mode_ = READ_SYNC;
+    read_mode_selected_ = true;
+  }
+
+  if (read_mode_ == READ_BULK)
+    result = bulkRead(&read_log);
+  else
+    result = syncRead(&read_log);
+
+  if (log != NULL)
+    *log = read_log;
+  else if (result == false && read_log != NULL)
+    RM_LOG::ERROR(read_log);
+  return result;
+}
+
+bool DynamixelBus::syncRead(const char **log)
+{
+  bool result = false;
+
+  const uint8_t id_num = id_.size();
+  uint8_t *id_array = &id_[0];
+
+  //////////////sync read of the workbench//////////////
+  const uint8_t handler = indirect_address_ ? SYNC_READ_HANDLER_FOR_PRESENT_MONITOR : SYNC_READ_HANDLER_FOR_PRESENT_POSITION_VELOCITY_CURRENT;
+  result = dynamixel_workbench_->syncRead(handler, id_array, id_num, log);
+  if (result == false)
+    return false;
+
+  // items of the region : current, velocity, position, then voltage, temperature, hardware error status
+  const uint16_t length[6] = {LENGTH_PRESENT_CURRENT_2, LENGTH_PRESENT_VELOCITY_2, LENGTH_PRESENT_POSITION_2,
+                              LENGTH_PRESENT_INPUT_VOLTAGE_2, LENGTH_PRESENT_TEMPERATURE_2, LENGTH_HARDWARE_ERROR_STATUS_2};
+  const uint8_t item_num = indirect_address_ ? 6 : 3;
+  uint16_t address = read_address_;
+  for (uint8_t item = 0; item < item_num; item++)
+  {
+    result = dynamixel_workbench_->getSyncReadData(handler, id_array, id_num, address, length[item], &raw_value_[item * id_num], log);
+    if (result == false)
+      return false;
+    address += length[item];
+  }
+
+  for (uint8_t index = 0; index < id_num; index++)
+  {
+    convertPresentValue(index, raw_value_[index], raw_value_[id_num + index], raw_value_[2 * id_num + index]);
+    if (indirect_address_)
+      convertMonitorValue(index, raw_value_[3 * id_num + index], raw_value_[4 * id_num + index], raw_value_[5 * id_num + index]);
+  }
+  return true;
+}
+
+bool DynamixelBus::bulkRead(const char **log)
+{
+  bool result = false;
+
+  const uint8_t id_num = id_.size();
+  uint8_t *id_array = &id_[0];
+
+  result = dynamixel_workbench_->bulkRead(log);
+  if (result == false)
+    return false;
+
+  for (uint8_t item = 0; item < 3; item++)
+  {
+    result = dynamixel_workbench_->getBulkReadData(id_array, id_num, &item_address_[item][0], &item_length_[item][0], &raw_value_[item * id_num], log);
+    if (result == false)
+      return false;
+  }
+
+  for (uint8_t index = 0; index < id_num; index++)
+    convertPresentValue(index, raw_value_[index], raw_value_[id_num + index], raw_value_[2 * id_num + index]);
+  return true;
+}
+
+bool DynamixelBus::getPresentValue(uint8_t actuator_id, double *current, double *velocity, double *position)
+{
+  int8_t index = findIndex(actuator_id);
+  if (index < 0)
+    return false;
+
+  // the value of this id was taken on this tick already : the next tick starts
+  if (present_fresh_.at(index) == 0 && takePresentValue() == false)
+    return false;
+
+  present_fresh_.at(index) = 0;
+  *current = present_read_->current.at(index);
+  *velocity = present_read_->velocity.at(index);
+  *position = present_read_->position.at(index);
+  return true;
+}
+
+bool DynamixelBus::getMonitorValue(uint8_t actuator_id, double *voltage, double *temperature, uint8_t *hardware_error)
+{
+  int8_t index = findIndex(actuator_id);
+  if (index < 0 || indirect_address_ == false)
+    return false;
+
+  *voltage = present_read_->voltage.at(index);
+  *temperature = present_read_->temperature.at(index);
+  *hardware_error = present_read_->hardware_error.at(index);
+  return true;
+}
+
+bool DynamixelBus::takePresentValue()
+{
+  bool result = true;
+
+#if !defined(__OPENCR__)
+  // the values of the last cycle of the bus thread (the ones before while it is behind)
+  if (io_running_)
+  {
+    if (present_buffer_.take())
+      present_read_ = &present_buffer_.getReadBuffer();
+  }
+  else
+    result = readPresentValue();
+#else
+  result = readPresentValue();
+#endif
+
+  if (result == false)
+    return false;
+
+  present_fresh_.assign(id_.size(), 1);
+  return true;
+}
+
+bool DynamixelBus::isAllStaged()
+{
+  for (uint8_t index = 0; index < goal_type_.size(); index++)
+  {
+    if (goal_type_.at(index) == GOAL_NONE)
+      return false;
+  }
+  return true;
+}
+
+bool DynamixelBus::stageGoalPosition(uint8_t actuator_id, int32_t position)
+{
+  int8_t index = findIndex(actuator_id);
+  if (index < 0)
+    return false;
+
+  // a goal of the id is still waiting : it goes out first
+  if (goal_type_.at(index) != GOAL_NONE)
+    writeGoalValue();
+
+  goal_type_.at(index) = GOAL_POSITION;
+  goal_value_.at((index + 1) * NUM_OF_GOAL_PWM_TO_GOAL_POSITION_ITEM - 1) = position;
+
+  return isAllStaged() ? writeGoalValue() : true;
+}
+
+bool DynamixelBus::stageGoalCurrentPosition(uint8_t actuator_id, int32_t goal_current, int32_t position)
+{
+  int8_t index = findIndex(actuator_id);
+  const GoalRegister *goal_register = getGoalRegister(actuator_id);
+  if (index < 0 || goal_register == NULL)
+  {
+    RM_LOG::ERROR("Gravity compensation mode is not set on the Dynamixel");
+    return false;
+  }
+
+  if (goal_type_.at(index) != GOAL_NONE)
+    writeGoalValue();
+
+  goal_type_.at(index) = GOAL_CURRENT_POSITION;
+  int32_t *goal = &goal_value_.at(index * NUM_OF_GOAL_PWM_TO_GOAL_POSITION_ITEM);
+  goal[0] = (goal_register->goal_pwm & 0xFFFF) | (goal_current << 16); // Goal_PWM, Goal_Current
+  goal[1] = 0;                                                            // Goal_Velocity (not used in this mode)
+  goal[2] = goal_register->profile_acceleration;
+  goal[3] = goal_register->profile_velocity;
+  goal[4] = position;
+
+  return isAllStaged() ? writeGoalValue() : true;
+}
+
+bool DynamixelBus::prepareGoalValue()
+{
+  bool goal_current = false;
+  for (uint8_t index = 0; index < id_.size(); index++)
+  {
+    if (goal_type_.at(index) == GOAL_CURRENT_POSITION)
+      goal_current = true;
+  }
+  if (goal_current == false)
+    return true;
+
+  // one write of Goal_PWM ~ Goal_Position : the goal position only ids put back their own registers
+  for (uint8_t index = 0; index < id_.size(); index++)
+  {
+    if (goal_type_.at(index) != GOAL_POSITION)
+      continue;
+
+    if (getGoalRegister(id_.at(index)) == NULL)
+    {
+      PortLock lock(this);
+      readGoalRegister(std::vector<uint8_t>(1, id_.at(index)));
+    }
+
+    const GoalRegister *goal_register = getGoalRegister(id_.at(index));
+    if (goal_register == NULL)
+      return false;
+
+    int32_t *goal = &goal_value_.at(index * NUM_OF_GOAL_PWM_TO_GOAL_POSITION_ITEM);
+    goal[0] = (goal_register->goal_pwm & 0xFFFF) | (goal_register->goal_current << 16);
+    goal[1] = 0;
+    goal[2] = goal_register->profile_acceleration;
+    goal[3] = goal_register->profile_velocity;
+  }
+  return true;
+}
+
+bool DynamixelBus::sendGoalValue(const uint8_t *goal_type, const int32_t *goal_value)
+{
+  bool result = false;
+  const char* log = NULL;
+
+  uint8_t id_array[id_.size()];
+  int32_t write_value[id_.size() * NUM_OF_GOAL_PWM_TO_GOAL_POSITION_ITEM];
+  uint8_t id_num = 0;
+  bool goal_current = false;
+
+  for (uint8_t index = 0; index < id_.size(); index++)
+  {
+    if (goal_type[index] != GOAL_NONE)
+      id_array[id_num++] = id_.at(index);
+    if (goal_type[index] == GOAL_CURRENT_POSITION)
+      goal_current = true;
+  }
+  if (id_num == 0)
+    return true;
+
+  if (goal_current == false)
+  {
+    uint8_t num = 0;
+    for (uint8_t index = 0; index < id_.size(); index++)
+    {
+      if (goal_type[index] != GOAL_NONE)
+        write_value[num++] = goal_value[(index + 1) * NUM_OF_GOAL_PWM_TO_GOAL_POSITION_ITEM - 1];
+    }
+    result = dynamixel_workbench_->syncWrite(SYNC_WRITE_HANDLER_FOR_GOAL_POSITION, id_array, id_num, write_value, 1, &log);
+  }
+  else
+  {
+    // Goal_PWM ~ Goal_Position of every id (filled by prepareGoalValue)
+    uint8_t num = 0;
+    for (uint8_t index = 0; index < id_.size(); index++)
+    {
+      if (goal_type[index] == GOAL_NONE)
+        continue;
+
+      for (uint8_t item = 0; item < NUM_OF_GOAL_PWM_TO_GOAL_POSITION_ITEM; item++)
+        write_value[num * NUM_OF_GOAL_PWM_TO_GOAL_POSITION_ITEM + item] = goal_value[index * NUM_OF_GOAL_PWM_TO_GOAL_POSITION_ITEM + item];
+      num++;
+    }
+
+    result = addGoalCurrentHandler();
+    if (result)
+      result = dynamixel_workbench_->syncWrite(SYNC_WRITE_HANDLER_FOR_GOAL_CURRENT_POSITION, id_array, id_num, write_value, NUM_OF_GOAL_PWM_TO_GOAL_POSITION_ITEM, &log);
+  }
+
+  if (result == false)
+  {
+    if (log != NULL)
+      RM_LOG::ERROR(log);
+    return false;
+  }
+
+  return true;
+}
+
+bool DynamixelBus::writeGoalValue()
+{
+  bool result = false;
+
+  uint8_t id_num = 0;
+  for (uint8_t index = 0; index < id_.size(); index++)
+  {
+    if (goal_type_.at(index) != GOAL_NONE)
+      id_num++;
+  }
+  if (id_num == 0)
+    return true;
+
+  result = prepareGoalValue();
+  if (result)
+  {
+#if !defined(__OPENCR__)
+    // written by the bus thread on its next cycle
+    // (an id staged on a tick the bus thread skipped keeps its goal until it is written)
+    if (io_running_)
+    {
+      if (goal_buffer_.isPending() == false)
+        goal_unsent_.type.assign(id_.size(), GOAL_NONE);
+
+      for (uint8_t index = 0; index < id_.size(); index++)
+      {
+        if (goal_type_.at(index) == GOAL_NONE)
+          continue;
+        goal_unsent_.type.at(index) = goal_type_.at(index);
+        std::copy(goal_value_.begin() + index * NUM_OF_GOAL_PWM_TO_GOAL_POSITION_ITEM,
+                  goal_value_.begin() + (index + 1) * NUM_OF_GOAL_PWM_TO_GOAL_POSITION_ITEM,
+                  goal_unsent_.value.begin() + index * NUM_OF_GOAL_PWM_TO_GOAL_POSITION_ITEM);
+      }
+
+      GoalValue &goal = goal_buffer_.getWriteBuffer();
+      goal.type = goal_unsent_.type;
+      goal.value = goal_unsent_.value;
+      goal_buffer_.publish();
+    }
+    else
+      result = sendGoalValue(&goal_type_[0], &goal_value_[0]);
+#else
+    result = sendGoalValue(&goal_type_[0], &goal_value_[0]);
+#endif
+  }
+
+  goal_type_.assign(id_.size(), GOAL_NONE);
+  return result;
+}
+
+bool DynamixelBus::endControlCycle()
+{
+  bool result = writeGoalValue();
+
+#if !defined(__OPENCR__)
+  if (io_running_)
+  {
+    {
+      std::lock_guard<std::mutex> lock(io_mutex_);
+      io_cycle_++;
+    }
+    io_condition_.notify_one();
+  }
+#endif
+
+  return result;
+}
+
+bool DynamixelBus::startIOThread()
+{
+#if defined(__OPENCR__)
+  RM_LOG::ERROR("[dynamixel bus]no bus thread on OpenCR");
+  return false;
+#else
+  if (io_running_)
+    return true;
+
+  // the first values come from the control thread, the staged goals go out before the bus thread has the port
+  if (id_.size() == 0 || readPresentValue() == false)
+  {
+    RM_LOG::ERROR("[dynamixel bus]fail to read the present values before the bus thread");
+    return false;
+  }
+  writeGoalValue();
+
+  GoalValue goal;
+  goal.type.assign(id_.size(), GOAL_NONE);
+  goal.value.assign(goal_value_.size(), 0);
+  goal_buffer_.fill(goal);
+  goal_unsent_ = goal;
+  present_buffer_.fill(present_);
+  present_read_ = &present_buffer_.getReadBuffer();
+
+  io_cycle_ = 0;
+  io_stop_ = false;
+  io_thread_ = std::thread(&DynamixelBus::ioLoop, this);
+  io_running_ = true;
+  RM_LOG::INFO("[dynamixel bus]bus thread started");
+  return true;
+#endif
+}
+
+void DynamixelBus::stopIOThread()
+{
+#if !defined(__OPENCR__)
+  if (io_running_ == false)
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    io_stop_ = true;
+  }
+  io_condition_.notify_one();
+  io_thread_.join();
+  io_running_ = false;
+
+  // goals the bus thread did not write
+  if (goal_buffer_.take())
+    sendGoalValue(&goal_buffer_.getReadBuffer().type[0], &goal_buffer_.getReadBuffer().value[0]);
+
+  present_ = *present_read_;
+  present_read_ = &present_;
+#endif
+}
+
+void DynamixelBus::ioLoop()
+{
+#if !defined(__OPENCR__)
+  uint32_t done_cycle = 0;
+  uint32_t read_fail_count = 0;         // cycles in a row, logged when it starts and when it ends
+  const char* log = NULL;
+
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(io_mutex_);
+      while (io_stop_ == false && io_cycle_ == done_cycle)
+        io_condition_.wait(lock);
+
+      if (io_stop_)
+        return;
+      done_cycle = io_cycle_; // cycles asked while this one was busy are one
+    }
+
+    //////////////goals of the last tick out, present values of the next tick in//////////////
+    PortLock lock(this);
+    if (goal_buffer_.take())
+      sendGoalValue(&goal_buffer_.getReadBuffer().type[0], &goal_buffer_.getReadBuffer().value[0]);
+
+    if (readPresentValue(&log))
+    {
+      present_buffer_.getWriteBuffer() = present_;
+      present_buffer_.publish();
+
+      if (read_fail_count > 0)
+        RM_LOG::INFO("[dynamixel bus]present values read again, failed cycles : ", (double)read_fail_count, 0);
+      read_fail_count = 0;
+    }
+    else if (read_fail_count++ == 0)
+    {
+      RM_LOG::WARN("[dynamixel bus]fail to read the present values, the last ones are kept until a read succeeds");
+      if (log != NULL)
+        RM_LOG::WARN(log);
+    }
+  }
+#endif
+}
+
+void DynamixelBus::lockPort()
+{
+#if !defined(__OPENCR__)
+  port_mutex_.lock();
+#endif
+}
+
+void DynamixelBus::unlockPort()
+{
+#if !defined(__OPENCR__)
+  port_mutex_.unlock();
+#endif
+}
+
+//////////////////////////////////////joint actuator
+
 void JointDynamixel::init(std::vector<uint8_t> actuator_id, const void *arg)
 {
   STRING *get_arg_ = (STRING *)arg;
@@ -34,15 +865,30 @@ void JointDynamixel::setMode(std::vector<uint8_t> actuator_id, const void *arg)
 {
   bool result = false;
   // const char* log = NULL;
+  DynamixelBus::PortLock lock(bus_);
 
   STRING *get_arg_ = (STRING *)arg;
 
-  if (get_arg_[0] == "position_mode" || get_arg_[0] == "current_based_position_mode")
+  if (get_arg_[0] == "position_mode" || get_arg_[0] == "current_based_position_mode" || get_arg_[0] == "gravity_compensation_mode")
   {
     result = JointDynamixel::setOperatingMode(actuator_id, get_arg_[0]);
     if (result == false)
       return;
   }
+  else if (get_arg_[0] == "torque_constant")
+  {
+    double torque_constant = std::atof(get_arg_[1].c_str());
+    if (torque_constant <= 0.0)
+    {
+      RM_LOG::ERROR("Torque constant must be positive (N*m/A)");
+      return;
+    }
+    torque_constant_ = torque_constant;
+  }
+  else if (get_arg_[0] == "current_margin")
+  {
+    current_margin_ = std::atof(get_arg_[1].c_str());
+  }
   else
   {
     result = JointDynamixel::writeProfileValue(actuator_id, get_arg_[0], std::atoi(get_arg_[1].c_str()));
@@ -50,7 +896,7 @@ void JointDynamixel::setMode(std::vector<uint8_t> actuator_id, const void *arg)
       return;
   }
 
-  result = JointDynamixel::setSDKHandler(actuator_id.at(0));
+  result = JointDynamixel::setSDKHandler();
   if (result == false)
     return;
 }
@@ -64,6 +910,7 @@ void JointDynamixel::enable()
 {
   const char* log = NULL;
   bool result = false;
+  DynamixelBus::PortLock lock(bus_);
   
   for (uint32_t index = 0; index < dynamixel_.num; index++)
   {
@@ -80,6 +927,7 @@ void JointDynamixel::disable()
 {
   const char* log = NULL;
   bool result = false;
+  DynamixelBus::PortLock lock(bus_);
   
   for (uint32_t index = 0; index < dynamixel_.num; index++)
   {
@@ -96,13 +944,18 @@ bool JointDynamixel::sendJointActuatorValue(std::vector<uint8_t> actuator_id, st
 {
   bool result = false;
   std::vector<double> radian_vector;
+  std::vector<double> torque_vector;
 
   for(uint32_t index = 0; index < value_vector.size(); index++)
   {
     radian_vector.push_back(value_vector.at(index).value);
+    torque_vector.push_back(value_vector.at(index).effort);
   }
 
-  result = JointDynamixel::writeGoalPosition(actuator_id, radian_vector);
+  if (gravity_compensation_mode_)
+    result = JointDynamixel::writeGoalCurrentPosition(actuator_id, radian_vector, torque_vector);
+  else
+    result = JointDynamixel::writeGoalPosition(actuator_id, radian_vector);
   if (result == false)
     return false;
 
@@ -124,13 +977,10 @@ bool JointDynamixel::initialize(std::vector<uint8_t> actuator_id, STRING dxl_dev
   dynamixel_.id = actuator_id;
   dynamixel_.num = actuator_id.size();
 
-  dynamixel_workbench_ = new DynamixelWorkbench;
-
-  result = dynamixel_workbench_->init(dxl_device_name.c_str(), std::atoi(dxl_baud_rate.c_str()), &log);
-  if (result == false)
-  {
-    RM_LOG::ERROR(log);
-  }    
+  // the port is shared with the other actuators on it
+  bus_ = DynamixelBus::getBus(dxl_device_name, dxl_baud_rate);
+  dynamixel_workbench_ = bus_->getWorkbench();
+  bus_->addId(actuator_id);
 
   uint16_t get_model_number;
   for (uint8_t index = 0; index < dynamixel_.num; index++)
@@ -183,6 +1033,42 @@ bool JointDynamixel::setOperatingMode(std::vector<uint8_t> actuator_id, STRING d
       }
     }
   }
+  else if (dynamixel_mode == "gravity_compensation_mode")
+  {
+    if (dynamixel_workbench_->getProtocolVersion() != 2.0f)
+    {
+      RM_LOG::ERROR("Gravity compensation mode needs Dynamixel protocol 2.0");
+      return false;
+    }
+
+    for (uint8_t num = 0; num < actuator_id.size(); num++)
+    {
+      result = dynamixel_workbench_->currentBasedPositionMode(actuator_id.at(num), current, &log);
+      if (result == false)
+      {
+        RM_LOG::ERROR(log);
+        return false;
+      }
+    }
+
+    // full current until the first goal comes with its feed-forward torque
+    if (bus_->readGoalRegister(actuator_id) == false)
+      return false;
+
+    for (uint8_t num = 0; num < actuator_id.size(); num++)
+    {
+      int32_t current_limit = bus_->getGoalRegister(actuator_id.at(num))->current_limit;
+      result = dynamixel_workbench_->writeRegister(actuator_id.at(num), "Goal_Current", current_limit, &log);
+      if (result == false)
+      {
+        RM_LOG::ERROR(log);
+        continue;
+      }
+      bus_->updateGoalRegister(actuator_id.at(num), "Goal_Current", current_limit);
+    }
+    gravity_compensation_mode_ = true;
+    return true;
+  }
   else
   {
     for (uint8_t num = 0; num < actuator_id.size(); num++)
@@ -195,29 +1081,14 @@ bool JointDynamixel::setOperatingMode(std::vector<uint8_t> actuator_id, STRING d
     }
   }
 
+  gravity_compensation_mode_ = false;
   return true;
 }
 
-bool JointDynamixel::setSDKHandler(uint8_t actuator_id)
+bool JointDynamixel::setSDKHandler()
 {
-  bool result = false;
-  const char* log = NULL;
-
-  result = dynamixel_workbench_->addSyncWriteHandler(actuator_id, "Goal_Position", &log);
-  if (result == false)
-  {
-    RM_LOG::ERROR(log);
-  }
-
-  result = dynamixel_workbench_->addSyncReadHandler(ADDR_PRESENT_CURRENT_2, 
-                                                    (LENGTH_PRESENT_CURRENT_2 + LENGTH_PRESENT_VELOCITY_2 + LENGTH_PRESENT_POSITION_2), 
-                                                    &log);
-  if (result == false)
-  {
-    RM_LOG::ERROR(log);
-  }
-
-  return true;
+  // the goal current + goal position handler is added by the bus on its first write
+  return bus_->setSDKHandler();
 }
 
 bool JointDynamixel::writeProfileValue(std::vector<uint8_t> actuator_id, STRING profile_mode, uint32_t value)
@@ -233,7 +1104,9 @@ bool JointDynamixel::writeProfileValue(std::vector<uint8_t> actuator_id, STRING
     if (result == false)
     {
       RM_LOG::ERROR(log);
+      continue;
     }
+    bus_->updateGoalRegister(actuator_id.at(num), profile_mode, value);
   }
 
   return true;
@@ -241,93 +1114,69 @@ bool JointDynamixel::writeProfileValue(std::vector<uint8_t> actuator_id, STRING
 
 bool JointDynamixel::writeGoalPosition(std::vector<uint8_t> actuator_id, std::vector<double> radian_vector)
 {
-  bool result = false;
-  const char* log = NULL;
-
-  uint8_t id_array[actuator_id.size()];
-  int32_t goal_position[actuator_id.size()];
+  bool result = true;
 
+  // staged on the bus, written along with the gripper in one sync write
   for (uint8_t index = 0; index < actuator_id.size(); index++)
   {
-    id_array[index] = actuator_id.at(index);
-    goal_position[index] = dynamixel_workbench_->convertRadian2Value(actuator_id.at(index), radian_vector.at(index));
-  }
-
-  result = dynamixel_workbench_->syncWrite(SYNC_WRITE_HANDLER_FOR_GOAL_POSITION, id_array, actuator_id.size(), goal_position, 1, &log);
-  if (result == false)
-  {
-    RM_LOG::ERROR(log);
+    int32_t goal_position = dynamixel_workbench_->convertRadian2Value(actuator_id.at(index), radian_vector.at(index));
+    if (bus_->stageGoalPosition(actuator_id.at(index), goal_position) == false)
+      result = false;
   }
 
-  return true;
+  return result;
 }
 
-std::vector<ROBOTIS_MANIPULATOR::Actuator> JointDynamixel::receiveAllDynamixelValue(std::vector<uint8_t> actuator_id)
+bool JointDynamixel::writeGoalCurrentPosition(std::vector<uint8_t> actuator_id, std::vector<double> radian_vector, std::vector<double> torque_vector)
 {
-  bool result = false;
-  const char* log = NULL;
+  bool result = true;
 
-  std::vector<ROBOTIS_MANIPULATOR::Actuator> all_actuator;
+  int32_t current_margin = dynamixel_workbench_->convertCurrent2Value(current_margin_);
 
-  uint8_t id_array[actuator_id.size()];
   for (uint8_t index = 0; index < actuator_id.size(); index++)
-    id_array[index] = actuator_id.at(index);
+  {
+    const GoalRegister *goal_register = bus_->getGoalRegister(actuator_id.at(index));
+    if (goal_register == NULL)
+    {
+      RM_LOG::ERROR("Gravity compensation mode is not set on the Dynamixel");
+      return false;
+    }
 
-  int32_t get_current[actuator_id.size()];
-  int32_t get_velocity[actuator_id.size()];
-  int32_t get_position[actuator_id.size()];
+    // feed-forward current of the torque (mA -> value)
+    int32_t current = dynamixel_workbench_->convertCurrent2Value(torque_vector.at(index) / torque_constant_ * 1000.0);
+    if (current > goal_register->current_limit)       current = goal_register->current_limit;
+    else if (current < -goal_register->current_limit) current = -goal_register->current_limit;
 
-  result = dynamixel_workbench_->syncRead(SYNC_READ_HANDLER_FOR_PRESENT_POSITION_VELOCITY_CURRENT,
-                                          id_array,
-                                          actuator_id.size(),
-                                          &log);
-  if (result == false)
-  {
-    RM_LOG::ERROR(log);
-  }
+    // goal current is the limit of the position loop, not an offset :
+    // the goal position is biased so that the P term (KPP = Position_P_Gain / 128) gives the feed-forward current
+    int32_t position_bias = 0;
+    if (goal_register->position_p_gain > 0)
+      position_bias = (current * 128) / goal_register->position_p_gain;
 
-  result = dynamixel_workbench_->getSyncReadData(SYNC_READ_HANDLER_FOR_PRESENT_POSITION_VELOCITY_CURRENT,
-                                                id_array,
-                                                actuator_id.size(),
-                                                ADDR_PRESENT_CURRENT_2,
-                                                LENGTH_PRESENT_CURRENT_2,
-                                                get_current,
-                                                &log);
-  if (result == false)
-  {
-    RM_LOG::ERROR(log);
-  }
+    int32_t goal_current = std::abs(current) + current_margin;
+    if (goal_current > goal_register->current_limit)
+      goal_current = goal_register->current_limit;
 
-  result = dynamixel_workbench_->getSyncReadData(SYNC_READ_HANDLER_FOR_PRESENT_POSITION_VELOCITY_CURRENT,
-                                                 id_array,
-                                                 actuator_id.size(),
-                                                ADDR_PRESENT_VELOCITY_2,
-                                                LENGTH_PRESENT_VELOCITY_2,
-                                                get_velocity,
-                                                &log);
-  if (result == false)
-  {
-    RM_LOG::ERROR(log);
+    int32_t goal_position = dynamixel_workbench_->convertRadian2Value(actuator_id.at(index), radian_vector.at(index)) + position_bias;
+    if (bus_->stageGoalCurrentPosition(actuator_id.at(index), goal_current, goal_position) == false)
+      result = false;
   }
 
-  result = dynamixel_workbench_->getSyncReadData(SYNC_READ_HANDLER_FOR_PRESENT_POSITION_VELOCITY_CURRENT,
-                                                 id_array,
-                                                 actuator_id.size(),
-                                                ADDR_PRESENT_POSITION_2,
-                                                LENGTH_PRESENT_POSITION_2,
-                                                get_position,
-                                                &log);
-  if (result == false)
-  {
-    RM_LOG::ERROR(log);
-  }
+  return result;
+}
+
+std::vector<ROBOTIS_MANIPULATOR::Actuator> JointDynamixel::receiveAllDynamixelValue(std::vector<uint8_t> actuator_id)
+{
+  std::vector<ROBOTIS_MANIPULATOR::Actuator> all_actuator;
+  all_actuator.reserve(actuator_id.size());
 
+  // one sync read of every id on the bus (gripper included) per tick, converted by the bus
   for (uint8_t index = 0; index < actuator_id.size(); index++)
   {
     ROBOTIS_MANIPULATOR::Actuator actuator;
-    actuator.effort = dynamixel_workbench_->convertValue2Current(get_current[index]);
-    actuator.velocity = dynamixel_workbench_->convertValue2Velocity(actuator_id.at(index), get_velocity[index]);
-    actuator.value = dynamixel_workbench_->convertValue2Radian(actuator_id.at(index), get_position[index]);
+    actuator.effort = actuator.velocity = actuator.value = 0.0;
+    if (bus_->getPresentValue(actuator_id.at(index), &actuator.effort, &actuator.velocity, &actuator.value) == false)
+      RM_LOG::ERROR("Fail to read the present value of the Joint Dynamixel");
 
     all_actuator.push_back(actuator);
   }
@@ -351,6 +1200,7 @@ void GripperDynamixel::setMode(const void *arg)
 {
   bool result = false;
 // const char* log = NULL;
+  DynamixelBus::PortLock lock(bus_);
 
   STRING *get_arg_ = (STRING *)arg;
 
@@ -381,6 +1231,7 @@ void GripperDynamixel::enable()
 {
   const char* log = NULL;
   bool result = false;
+  DynamixelBus::PortLock lock(bus_);
   
   result = dynamixel_workbench_->torqueOn(dynamixel_.id.at(0), &log);
   if (result == false)
@@ -394,6 +1245,7 @@ void GripperDynamixel::disable()
 {
   const char* log = NULL;
   bool result = false;
+  DynamixelBus::PortLock lock(bus_);
   
   result = dynamixel_workbench_->torqueOff(dynamixel_.id.at(0), &log);
   if (result == false)
@@ -423,13 +1275,10 @@ bool GripperDynamixel::initialize(uint8_t actuator_id, STRING dxl_device_name, S
   dynamixel_.id.push_back(actuator_id);
   dynamixel_.num = 1;
 
-  dynamixel_workbench_ = new DynamixelWorkbench;
-
-  result = dynamixel_workbench_->init(dxl_device_name.c_str(), std::atoi(dxl_baud_rate.c_str()), &log);
-  if (result == false)
-  {
-    RM_LOG::ERROR(log);
-  }
+  // same port as the joints : read and written in their sync packets
+  bus_ = DynamixelBus::getBus(dxl_device_name, dxl_baud_rate);
+  dynamixel_workbench_ = bus_->getWorkbench();
+  bus_->addId(dynamixel_.id);
 
   uint16_t get_model_number;
   result = dynamixel_workbench_->ping(dynamixel_.id.at(0), &get_model_number, &log);
@@ -473,6 +1322,7 @@ bool GripperDynamixel::setOperatingMode(STRING dynamixel_mode)
     {
       RM_LOG::ERROR(log);
     }
+    bus_->updateGoalRegister(dynamixel_.id.at(0), "Goal_Current", current);
   }
   else
   {
@@ -498,76 +1348,34 @@ bool GripperDynamixel::writeProfileValue(STRING profile_mode, uint32_t value)
   {
     RM_LOG::ERROR(log);
   }
+  else
+  {
+    bus_->updateGoalRegister(dynamixel_.id.at(0), profile_mode, value);
+  }
 
   return true;
 }
 
 bool GripperDynamixel::setSDKHandler()
 {
-  bool result = false;
-  const char* log = NULL;
-
-  result = dynamixel_workbench_->addSyncWriteHandler(dynamixel_.id.at(0), "Goal_Position", &log);
-  if (result == false)
-  {
-    RM_LOG::ERROR(log);
-  }
-
-  result = dynamixel_workbench_->addSyncReadHandler(dynamixel_.id.at(0),
-                                                    "Present_Position", 
-                                                    &log);
-  if (result == false)
-  {
-    RM_LOG::ERROR(log);
-  }
-
-  return true;
+  return bus_->setSDKHandler();
 }
 
 bool GripperDynamixel::writeGoalPosition(double radian)
 {
-  bool result = false;
-  const char* log = NULL;
-
-  int32_t goal_position = 0;
-
-  goal_position = dynamixel_workbench_->convertRadian2Value(dynamixel_.id.at(0), radian);
-
-  result = dynamixel_workbench_->syncWrite(SYNC_WRITE_HANDLER_FOR_GOAL_POSITION, &goal_position, &log);
-  if (result == false)
-  {
-    RM_LOG::ERROR(log);
-  }
+  int32_t goal_position = dynamixel_workbench_->convertRadian2Value(dynamixel_.id.at(0), radian);
 
-  return true;
+  // staged on the bus, written along with the joints in one sync write
+  return bus_->stageGoalPosition(dynamixel_.id.at(0), goal_position);
 }
 
 double GripperDynamixel::receiveDynamixelValue()
 {
-  bool result = false;
-  const char* log = NULL;
+  double get_current = 0.0, get_velocity = 0.0, get_position = 0.0;
 
-  int32_t get_value = 0;
-  uint8_t id_array[1] = {dynamixel_.id.at(0)};
-
-  result = dynamixel_workbench_->syncRead(SYNC_READ_HANDLER_FOR_PRESENT_POSITION_VELOCITY_CURRENT, 
-                                          id_array,
-                                          (uint8_t)1,
-                                          &log);
-  if (result == false)
-  {
-    RM_LOG::ERROR(log);
-  }
-
-  result = dynamixel_workbench_->getSyncReadData(SYNC_READ_HANDLER_FOR_PRESENT_POSITION_VELOCITY_CURRENT, 
-                                            id_array,
-                                            (uint8_t)1,
-                                            &get_value, 
-                                            &log);
-  if (result == false)
-  {
-    RM_LOG::ERROR(log);
-  } 
+  // taken from the sync read of the joints on this tick
+  if (bus_->getPresentValue(dynamixel_.id.at(0), &get_current, &get_velocity, &get_position) == false)
+    RM_LOG::ERROR("Fail to read the present value of the Gripper Dynamixel");
 
-  return dynamixel_workbench_->convertValue2Radian(dynamixel_.id.at(0), get_value);
+  return get_position;
 }
@@ -18,539 +18,1700 @@
 
 #include "../include/open_manipulator_libs/Kinematics.h"
 
+#include <algorithm>
+
+#if defined(__AVX2__)
+  #include <immintrin.h>
+#endif
+#if !defined(__OPENCR__)
+  #include <cstdio>
+  #include <cstring>
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <time.h>
+  #include <unistd.h>
+#endif
+
 using namespace ROBOTIS_MANIPULATOR;
 using namespace KINEMATICS;
 
-void Chain::updatePassiveJointValue(Manipulator *manipulator){}
+//-------------------- Axis Rotation --------------------//
 
-Eigen::MatrixXd Chain::jacobian(Manipulator *manipulator, Name tool_name)
+AxisType KINEMATICS::getAxisType(const Eigen::Vector3d &axis)
 {
-  Eigen::MatrixXd jacobian = Eigen::MatrixXd::Identity(6, manipulator->getDOF());
-
-  Eigen::Vector3d joint_axis = ZERO_VECTOR;
-
-  Eigen::Vector3d position_changed = ZERO_VECTOR;
-  Eigen::Vector3d orientation_changed = ZERO_VECTOR;
-  Eigen::VectorXd pose_changed = Eigen::VectorXd::Zero(6);
-
-  int8_t index = 0;
-  Name my_name =  manipulator->getWorldChildName();
+  if (axis(0) == 0.0 && axis(1) == 0.0 && axis(2) == 0.0)
+    return AXIS_NONE;
+  else if (axis(0) == 1.0 && axis(1) == 0.0 && axis(2) == 0.0)
+    return AXIS_X;
+  else if (axis(0) == 0.0 && axis(1) == 1.0 && axis(2) == 0.0)
+    return AXIS_Y;
+  else if (axis(0) == 0.0 && axis(1) == 0.0 && axis(2) == 1.0)
+    return AXIS_Z;
+  else
+    return AXIS_OTHER;
+}
 
-  for (int8_t size = 0; size < manipulator->getDOF(); size++)
+void KINEMATICS::rotateAboutAxis(const Eigen::Matrix3d &parent_rotation, AxisType axis_type, const Eigen::Vector3d &axis,
+                                 double sin_value, double cos_value, Eigen::Matrix3d *rotation)
+{
+  switch (axis_type)
   {
-    Name parent_name = manipulator->getComponentParentName(my_name);
-    if (parent_name == manipulator->getWorldName())
-    {
-      joint_axis = manipulator->getWorldOrientation() * manipulator->getAxis(my_name);
-    }
-    else
-    {
-      joint_axis = manipulator->getComponentOrientationFromWorld(parent_name) * manipulator->getAxis(my_name);
-    }
-
-    position_changed = RM_MATH::skewSymmetricMatrix(joint_axis) *
-                       (manipulator->getComponentPositionFromWorld(tool_name) - manipulator->getComponentPositionFromWorld(my_name));
-    orientation_changed = joint_axis;
-
-    pose_changed << position_changed(0),
-        position_changed(1),
-        position_changed(2),
-        orientation_changed(0),
-        orientation_changed(1),
-        orientation_changed(2);
-
-    jacobian.col(index) = pose_changed;
-    index++;
-    my_name = manipulator->getComponentChildName(my_name).at(0); // Get Child name which has active joint
+  case AXIS_NONE:
+    *rotation = parent_rotation;
+    break;
+  case AXIS_X:
+    rotation->col(0) = parent_rotation.col(0);
+    rotation->col(1) = cos_value * parent_rotation.col(1) + sin_value * parent_rotation.col(2);
+    rotation->col(2) = cos_value * parent_rotation.col(2) - sin_value * parent_rotation.col(1);
+    break;
+  case AXIS_Y:
+    rotation->col(0) = cos_value * parent_rotation.col(0) - sin_value * parent_rotation.col(2);
+    rotation->col(1) = parent_rotation.col(1);
+    rotation->col(2) = cos_value * parent_rotation.col(2) + sin_value * parent_rotation.col(0);
+    break;
+  case AXIS_Z:
+    rotation->col(0) = cos_value * parent_rotation.col(0) + sin_value * parent_rotation.col(1);
+    rotation->col(1) = cos_value * parent_rotation.col(1) - sin_value * parent_rotation.col(0);
+    rotation->col(2) = parent_rotation.col(2);
+    break;
+  default:
+  {
+    Eigen::Matrix3d skew_symmetric_matrix = RM_MATH::skewSymmetricMatrix(axis);
+    *rotation = parent_rotation * (Eigen::Matrix3d::Identity() + skew_symmetric_matrix * sin_value +
+                                   skew_symmetric_matrix * skew_symmetric_matrix * (1 - cos_value));
+    break;
+  }
   }
-  return jacobian;
 }
 
-void Chain::forwardKinematics(Manipulator *manipulator)
+//-------------------- Chain State --------------------//
+
+void ChainState::setName(const std::vector<Name> &name)
 {
-  forwardSolverUsingChainRule(manipulator, manipulator->getWorldChildName());
+  if (name.size() > CHAIN_STATE_SIZE)
+  {
+    RM_LOG::WARN("[chain state]too many links to publish : ", (double)name.size(), 0);
+    name_.clear();
+    return;
+  }
+  name_ = name;
+  sequence_.store(0, std::memory_order_release);
 }
 
-bool Chain::inverseKinematics(Manipulator *manipulator, Name tool_name, Pose target_pose, std::vector<double> *goal_joint_value)
+int8_t ChainState::findIndex(Name name) const
 {
-  if(inverse_solver_option_ == "position_only_inverse")
-    return inverseSolverUsingPositionOnlySRJacobian(manipulator, tool_name, target_pose, goal_joint_value);
-  else if (inverse_solver_option_ == "sr_inverse")
-    return inverseSolverUsingSRJacobian(manipulator, tool_name, target_pose, goal_joint_value);
-  else if(inverse_solver_option_ == "chain_custum_inverse_kinematics")
-    return chainCustomInverseKinematics(manipulator, tool_name, target_pose, goal_joint_value);
-  else if(inverse_solver_option_ == "normal_inverse")
-    return inverseSolverUsingJacobian(manipulator, tool_name, target_pose, goal_joint_value);
-  else
+  for (uint8_t index = 0; index < name_.size(); index++)
   {
-    RM_LOG::ERROR("Wrong inverse solver name (please change the solver)");
+    if (name_.at(index) == name)
+      return index;
   }
-  return false;
+  return -1;
 }
 
-void Chain::forwardSolverUsingChainRule(Manipulator *manipulator, Name component_name)
+void ChainState::write(const double *value)
 {
-  Name my_name = component_name;
-  Name parent_name = manipulator->getComponentParentName(my_name);
-  int8_t number_of_child = manipulator->getComponentChildName(my_name).size();
+  uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+  sequence_.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
 
-  Eigen::Vector3d parent_position_to_world, my_position_to_world;
-  Eigen::Matrix3d parent_orientation_to_world, my_orientation_to_world;
+  for (uint8_t index = 0; index < name_.size(); index++)
+    value_[index].store(value[index], std::memory_order_relaxed);
 
-  if (parent_name == manipulator->getWorldName())
+  sequence_.store(sequence + 2, std::memory_order_release);
+}
+
+bool ChainState::read(double *value) const
+{
+  while (true)
   {
-    parent_position_to_world = manipulator->getWorldPosition();
-    parent_orientation_to_world = manipulator->getWorldOrientation();
+    uint32_t sequence = sequence_.load(std::memory_order_acquire);
+    if (sequence == 0)
+      return false;
+    if (sequence & 1)
+      continue; // being written
+
+    for (uint8_t index = 0; index < name_.size(); index++)
+      value[index] = value_[index].load(std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence_.load(std::memory_order_relaxed) == sequence)
+      return true;
   }
-  else
+}
+
+//-------------------- IK Workspace --------------------//
+
+bool IKWorkspace::build(Manipulator *manipulator, Name tool_name, const std::map<Name, JointLimit> *joint_limit, const ChainState *state)
+{
+  if (dof_ == manipulator->getDOF() && dof_ > 0 && tool_name_ == tool_name)
+    return true;
+
+  dof_ = manipulator->getDOF();
+  tool_name_ = tool_name;
+
+  joint_name_.resize(dof_);
+  axis_.resize(dof_ + 1);
+  axis_type_.resize(dof_ + 1);
+  relative_position_.resize(dof_ + 1);
+  position_.resize(dof_ + 1);
+  orientation_.resize(dof_ + 1);
+  joint_value_.resize(dof_ + 1);
+  joint_max_.assign(dof_, HUGE_VAL);
+  joint_min_.assign(dof_, -HUGE_VAL);
+
+  world_position_ = manipulator->getWorldPosition();
+  world_orientation_ = manipulator->getWorldOrientation();
+
+  Name my_name = manipulator->getWorldChildName();
+  for (int8_t index = 0; index < dof_; index++)
   {
-    parent_position_to_world = manipulator->getComponentPositionFromWorld(parent_name);
-    parent_orientation_to_world = manipulator->getComponentOrientationFromWorld(parent_name);
+    joint_name_.at(index) = my_name;
+    axis_.at(index) = manipulator->getAxis(my_name);
+    axis_type_.at(index) = getAxisType(axis_.at(index));
+    relative_position_.at(index) = manipulator->getComponentRelativePositionFromParent(my_name);
+
+    if (joint_limit != NULL && joint_limit->find(my_name) != joint_limit->end())
+    {
+      joint_max_.at(index) = joint_limit->find(my_name)->second.max;
+      joint_min_.at(index) = joint_limit->find(my_name)->second.min;
+    }
+
+    if (index < dof_ - 1)
+      my_name = manipulator->getComponentChildName(my_name).at(0); // Get Child name which has active joint
   }
 
-  my_position_to_world = parent_orientation_to_world * manipulator->getComponentRelativePositionFromParent(my_name) + parent_position_to_world;
-  my_orientation_to_world = parent_orientation_to_world * RM_MATH::rodriguesRotationMatrix(manipulator->getAxis(my_name), manipulator->getValue(my_name));
+  axis_.at(dof_) = manipulator->getAxis(tool_name);
+  axis_type_.at(dof_) = getAxisType(axis_.at(dof_));
+  relative_position_.at(dof_) = manipulator->getComponentRelativePositionFromParent(tool_name);
 
-  manipulator->setComponentPositionFromWorld(my_name, my_position_to_world);
-  manipulator->setComponentOrientationFromWorld(my_name, my_orientation_to_world);
+  if (dof_ == 0 || manipulator->getComponentParentName(tool_name) != joint_name_.at(dof_ - 1))
+  {
+    RM_LOG::ERROR("[IK workspace]the tool is not at the end of the active joint chain");
+    dof_ = 0;
+    return false;
+  }
 
-  for (int8_t index = 0; index < number_of_child; index++)
+  state_index_.clear();
+  if (state != NULL)
   {
-    Name child_name = manipulator->getComponentChildName(my_name).at(index);
-    forwardSolverUsingChainRule(manipulator, child_name);
+    state_index_.resize(dof_ + 1);
+    for (int8_t index = 0; index <= dof_; index++)
+    {
+      state_index_.at(index) = state->findIndex((index < dof_) ? joint_name_.at(index) : tool_name_);
+      if (state_index_.at(index) < 0)
+      {
+        state_index_.clear();
+        break;
+      }
+    }
   }
+  return true;
 }
 
-bool Chain::inverseSolverUsingJacobian(Manipulator *manipulator, Name tool_name, Pose target_pose, std::vector<double>* goal_joint_value)
+void IKWorkspace::loadJointValue(Manipulator *manipulator, const ChainState *state)
 {
-  const double lambda = 0.7;
-  const int8_t iteration = 10;
+  double state_value[CHAIN_STATE_SIZE];
+  if (state != NULL && state_index_.size() == (size_t)dof_ + 1 && state->read(state_value))
+  {
+    for (int8_t index = 0; index <= dof_; index++)
+      joint_value_.at(index) = state_value[state_index_.at(index)];
+    return;
+  }
 
-  Manipulator _manipulator = *manipulator;
+  for (int8_t index = 0; index < dof_; index++)
+    joint_value_.at(index) = manipulator->getValue(joint_name_.at(index));
+  joint_value_.at(dof_) = manipulator->getValue(tool_name_);
+}
 
-  Eigen::MatrixXd jacobian = Eigen::MatrixXd::Identity(6, _manipulator.getDOF());
+bool IKWorkspace::load(Manipulator *manipulator, Name tool_name, const std::map<Name, JointLimit> *joint_limit, const ChainState *state)
+{
+  if (build(manipulator, tool_name, joint_limit, state) == false)
+    return false;
 
-  Eigen::VectorXd pose_changed = Eigen::VectorXd::Zero(6);
-  Eigen::VectorXd angle_changed = Eigen::VectorXd::Zero(_manipulator.getDOF());
+  loadJointValue(manipulator, state);
+  return true;
+}
 
-  std::vector<double> result;
+void IKWorkspace::setAllJointValue(const std::vector<double> &joint_value)
+{
+  for (int8_t index = 0; index < dof_; index++)
+    joint_value_.at(index) = joint_value.at(index);
+}
 
-  for (int8_t count = 0; count < iteration; count++)
+void IKWorkspace::clampJointValue()
+{
+  for (int8_t index = 0; index < dof_; index++)
   {
-    forwardKinematics(&_manipulator);
-
-    jacobian = this->jacobian(&_manipulator,tool_name);
+    if (joint_value_.at(index) > joint_max_.at(index))
+      joint_value_.at(index) = joint_max_.at(index);
+    else if (joint_value_.at(index) < joint_min_.at(index))
+      joint_value_.at(index) = joint_min_.at(index);
+  }
+}
 
-    pose_changed = RM_MATH::poseDifference(target_pose.position, _manipulator.getComponentPositionFromWorld(tool_name),
-                                           target_pose.orientation, _manipulator.getComponentOrientationFromWorld(tool_name));
-    if (pose_changed.norm() < 1E-6)
-    {
-      *goal_joint_value = _manipulator.getAllActiveJointValue();
-      return true;
-    }
+bool IKWorkspace::isInJointLimit()
+{
+  for (int8_t index = 0; index < dof_; index++)
+  {
+    if (joint_value_.at(index) > joint_max_.at(index) || joint_value_.at(index) < joint_min_.at(index))
+      return false;
+  }
+  return true;
+}
 
-    ColPivHouseholderQR<MatrixXd> dec(jacobian);
-    angle_changed = lambda * dec.solve(pose_changed);
+void IKWorkspace::forward()
+{
+  Eigen::Vector3d parent_position_to_world = world_position_;
+  Eigen::Matrix3d parent_orientation_to_world = world_orientation_;
 
-    std::vector<double> set_angle_changed;
-    for (int8_t index = 0; index < _manipulator.getDOF(); index++)
-      set_angle_changed.push_back(_manipulator.getAllActiveJointValue().at(index) + angle_changed(index));
+  for (int8_t index = 0; index <= dof_; index++)
+  {
+    position_.at(index) = parent_orientation_to_world * relative_position_.at(index) + parent_position_to_world;
+    rotateAboutAxis(parent_orientation_to_world, axis_type_.at(index), axis_.at(index),
+                    sin(joint_value_.at(index)), cos(joint_value_.at(index)), &orientation_.at(index));
 
-    _manipulator.setAllActiveJointValue(set_angle_changed);
+    parent_position_to_world = position_.at(index);
+    parent_orientation_to_world = orientation_.at(index);
   }
-  *goal_joint_value = _manipulator.getAllActiveJointValue();
-  return false;
 }
 
-bool Chain::inverseSolverUsingPositionOnlySRJacobian(Manipulator *manipulator, Name tool_name, Pose target_pose, std::vector<double>* goal_joint_value)
+template <int DOF>
+void IKWorkspace::forwardWithJacobian(Eigen::Matrix<double, 6, DOF> *jacobian)
 {
-  //manipulator
-  Manipulator _manipulator = *manipulator;
-
-  //solver parameter
-  double lambda = 0.0;
-  const double param = 0.002;
-  const int8_t iteration = 10;
-
-  const double gamma = 0.5;             //rollback delta
+  Eigen::Vector3d parent_position_to_world = world_position_;
+  Eigen::Matrix3d parent_orientation_to_world = world_orientation_;
 
-  //jacobian
-  Eigen::MatrixXd jacobian = Eigen::MatrixXd::Identity(6, _manipulator.getDOF());
-  Eigen::MatrixXd position_jacobian = Eigen::MatrixXd::Identity(3, _manipulator.getDOF());
-  Eigen::MatrixXd sr_jacobian = Eigen::MatrixXd::Identity(_manipulator.getDOF(), _manipulator.getDOF());
+  for (int8_t index = 0; index <= dof_; index++)
+  {
+    position_.at(index) = parent_orientation_to_world * relative_position_.at(index) + parent_position_to_world;
+    rotateAboutAxis(parent_orientation_to_world, axis_type_.at(index), axis_.at(index),
+                    sin(joint_value_.at(index)), cos(joint_value_.at(index)), &orientation_.at(index));
 
-  //delta parameter
-  Eigen::Vector3d position_changed = Eigen::VectorXd::Zero(3);
-  Eigen::VectorXd angle_changed = Eigen::VectorXd::Zero(_manipulator.getDOF());    //delta angle (dq)
-  Eigen::VectorXd gerr(_manipulator.getDOF());
+    if (index < dof_)
+      jacobian->template block<3, 1>(3, index) = parent_orientation_to_world * axis_.at(index); // joint axis from world
 
-  //sr sovler parameter
-  double wn_pos = 1 / 0.3;
-  double pre_Ek = 0.0;
-  double new_Ek = 0.0;
+    parent_position_to_world = position_.at(index);
+    parent_orientation_to_world = orientation_.at(index);
+  }
 
-  Eigen::MatrixXd We(3, 3);
-  We << wn_pos, 0, 0,
-      0, wn_pos, 0,
-      0, 0, wn_pos;
+  // linear part needs the tool position which is known at the end of the pass
+  for (int8_t index = 0; index < dof_; index++)
+    jacobian->template block<3, 1>(0, index) = jacobian->template block<3, 1>(3, index).cross(position_.at(dof_) - position_.at(index));
+}
+template void IKWorkspace::forwardWithJacobian<CHAIN_FIXED_DOF>(Eigen::Matrix<double, 6, CHAIN_FIXED_DOF> *jacobian);
+template void IKWorkspace::forwardWithJacobian<Eigen::Dynamic>(Eigen::Matrix<double, 6, Eigen::Dynamic> *jacobian);
 
-  Eigen::MatrixXd Wn = Eigen::MatrixXd::Identity(_manipulator.getDOF(), _manipulator.getDOF());
+//-------------------- FK Kernel --------------------//
 
-  //angle parameter
-  std::vector<double> present_angle;                                               //angle (q)
-  std::vector<double> set_angle;                                                   //set angle (q + dq)
+#if defined(__AVX2__)
+namespace
+{
+// sin and cos of 4 angles (cephes polynomials on [-pi/4, pi/4], |x| < 1E5)
+inline void sincos4(__m256d x, __m256d *sin_x, __m256d *cos_x)
+{
+  const __m256d sign_bit = _mm256_set1_pd(-0.0);
+
+  __m256d quadrant = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(M_2_PI)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  __m256d r = _mm256_sub_pd(x, _mm256_mul_pd(quadrant, _mm256_set1_pd(1.57079625129699707031E0)));
+  r = _mm256_sub_pd(r, _mm256_mul_pd(quadrant, _mm256_set1_pd(7.54978941586159635336E-8)));
+  r = _mm256_sub_pd(r, _mm256_mul_pd(quadrant, _mm256_set1_pd(5.39030285815811905290E-15)));
+  __m256d z = _mm256_mul_pd(r, r);
+
+  __m256d sin_r = _mm256_set1_pd(1.58962301576546568060E-10);
+  sin_r = _mm256_add_pd(_mm256_mul_pd(sin_r, z), _mm256_set1_pd(-2.50507477628578072866E-8));
+  sin_r = _mm256_add_pd(_mm256_mul_pd(sin_r, z), _mm256_set1_pd(2.75573136213857245213E-6));
+  sin_r = _mm256_add_pd(_mm256_mul_pd(sin_r, z), _mm256_set1_pd(-1.98412698295895385996E-4));
+  sin_r = _mm256_add_pd(_mm256_mul_pd(sin_r, z), _mm256_set1_pd(8.33333333332211858878E-3));
+  sin_r = _mm256_add_pd(_mm256_mul_pd(sin_r, z), _mm256_set1_pd(-1.66666666666666307295E-1));
+  sin_r = _mm256_add_pd(r, _mm256_mul_pd(_mm256_mul_pd(sin_r, z), r));
+
+  __m256d cos_r = _mm256_set1_pd(-1.13585365213876817300E-11);
+  cos_r = _mm256_add_pd(_mm256_mul_pd(cos_r, z), _mm256_set1_pd(2.08757008419747316778E-9));
+  cos_r = _mm256_add_pd(_mm256_mul_pd(cos_r, z), _mm256_set1_pd(-2.75573141792967388112E-7));
+  cos_r = _mm256_add_pd(_mm256_mul_pd(cos_r, z), _mm256_set1_pd(2.48015872888517045348E-5));
+  cos_r = _mm256_add_pd(_mm256_mul_pd(cos_r, z), _mm256_set1_pd(-1.38888888888730564116E-3));
+  cos_r = _mm256_add_pd(_mm256_mul_pd(cos_r, z), _mm256_set1_pd(4.16666666666665929218E-2));
+  cos_r = _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(cos_r, z), z), _mm256_sub_pd(_mm256_set1_pd(1.0), _mm256_mul_pd(_mm256_set1_pd(0.5), z)));
+
+  // quadrant mod 4 : 1, 3 swap sin and cos / 2, 3 negate sin / 1, 2 negate cos
+  __m256d quadrant_mod = _mm256_sub_pd(quadrant, _mm256_mul_pd(_mm256_set1_pd(4.0), _mm256_floor_pd(_mm256_mul_pd(quadrant, _mm256_set1_pd(0.25)))));
+  __m256d is_1 = _mm256_cmp_pd(quadrant_mod, _mm256_set1_pd(1.0), _CMP_EQ_OQ);
+  __m256d is_2 = _mm256_cmp_pd(quadrant_mod, _mm256_set1_pd(2.0), _CMP_EQ_OQ);
+  __m256d is_3 = _mm256_cmp_pd(quadrant_mod, _mm256_set1_pd(3.0), _CMP_EQ_OQ);
+  __m256d swap = _mm256_or_pd(is_1, is_3);
+
+  *sin_x = _mm256_xor_pd(_mm256_blendv_pd(sin_r, cos_r, swap), _mm256_and_pd(_mm256_or_pd(is_2, is_3), sign_bit));
+  *cos_x = _mm256_xor_pd(_mm256_blendv_pd(cos_r, sin_r, swap), _mm256_and_pd(_mm256_or_pd(is_1, is_2), sign_bit));
+}
+} // namespace
+#endif
 
-  ////////////////////////////solving//////////////////////////////////
+bool ChainFKKernel::build(Manipulator *manipulator, Name tool_name)
+{
+  IKWorkspace workspace;
+  dof_ = 0;
+  if (workspace.build(manipulator, tool_name) == false)
+    return false;
 
-  forwardKinematics(&_manipulator);
-  //////////////checking dx///////////////
-  position_changed = RM_MATH::positionDifference(target_pose.position, _manipulator.getComponentPositionFromWorld(tool_name));
-  pre_Ek = position_changed.transpose() * We * position_changed;
-  ///////////////////////////////////////
+  const int8_t dof = workspace.getDOF();
+  const Eigen::Vector3d z_axis = RM_MATH::makeVector3(0.0, 0.0, 1.0);
+  const Eigen::Vector3d y_axis = RM_MATH::makeVector3(0.0, 1.0, 0.0);
 
-  /////////////////////////////debug/////////////////////////////////
-  #if defined(KINEMATICS_DEBUG)
-  Eigen::Vector3d target_orientation_rpy = RM_MATH::convertRotationToRPY(target_pose.orientation);
-  Eigen::VectorXd debug_target_pose(6);
-  for(int t=0; t<3; t++)
-    debug_target_pose(t) = target_pose.position(t);
-  for(int t=0; t<3; t++)
-    debug_target_pose(t+3) = target_orientation_rpy(t);
+  bool is_planar = (workspace.getAxis(0) - z_axis).norm() < 1E-6;
+  for (int8_t index = 1; index < dof; index++)
+    is_planar = is_planar && ((workspace.getAxis(index) - y_axis).norm() < 1E-6);
 
-  Eigen::Vector3d present_position = _manipulator.getComponentPositionFromWorld(tool_name);
-  Eigen::MatrixXd present_orientation = _manipulator.getComponentOrientationFromWorld(tool_name);
-  Eigen::Vector3d present_orientation_rpy = RM_MATH::convertRotationToRPY(present_orientation);
-  Eigen::VectorXd debug_present_pose(6);
-  for(int t=0; t<3; t++)
-    debug_present_pose(t) = present_position(t);
-  for(int t=0; t<3; t++)
-    debug_present_pose(t+3) = present_orientation_rpy(t);
+  if (is_planar == false)
+  {
+    RM_LOG::ERROR("[FK kernel]the chain is not a yaw joint with planar pitch joints");
+    return false;
+  }
 
-  RM_LOG::PRINTLN("------------------------------------");
-  RM_LOG::WARN("iter : first");
-  RM_LOG::WARN("Ek : ", pre_Ek*1000000000000);
-  RM_LOG::PRINTLN("tar_pose");
-  RM_LOG::PRINTLN_VECTOR(debug_target_pose,16);
-  RM_LOG::PRINTLN("pre_pose");
-  RM_LOG::PRINTLN_VECTOR(debug_present_pose,16);
-  RM_LOG::PRINTLN("delta_pose");
-  RM_LOG::PRINTLN_VECTOR(debug_target_pose-debug_present_pose,16);
-  #endif
-  ////////////////////////////debug//////////////////////////////////
+  world_position_ = workspace.getWorldPosition();
+  world_orientation_ = workspace.getWorldOrientation();
+  base_offset_ = workspace.getRelativePosition(0);
 
-  //////////////////////////solving loop///////////////////////////////
-  for (int8_t count = 0; count < iteration; count++)
+  offset_y_ = 0.0;
+  offset_x_.resize(dof);
+  offset_z_.resize(dof);
+  for (int8_t index = 1; index <= dof; index++)
   {
-    //////////solve using jacobian//////////
-    jacobian = this->jacobian(&_manipulator, tool_name);
-    position_jacobian.row(0) = jacobian.row(0);
-    position_jacobian.row(1) = jacobian.row(1);
-    position_jacobian.row(2) = jacobian.row(2);
-    lambda = pre_Ek + param;
-
-    sr_jacobian = (position_jacobian.transpose() * We * position_jacobian) + (lambda * Wn);     //calculate sr_jacobian (J^T*we*J + lamda*Wn)
-    gerr = position_jacobian.transpose() * We * position_changed;                                //calculate gerr (J^T*we) dx
+    offset_x_.at(index - 1) = workspace.getRelativePosition(index)(0);
+    offset_z_.at(index - 1) = workspace.getRelativePosition(index)(2);
+    offset_y_ += workspace.getRelativePosition(index)(1);
+  }
 
-    ColPivHouseholderQR<Eigen::MatrixXd> dec(sr_jacobian);                    //solving (get dq)
-    angle_changed = dec.solve(gerr);                                          //(J^T*we) * dx = (J^T*we*J + lamda*Wn) * dq
+  dof_ = dof;
+  return true;
+}
 
-    present_angle = _manipulator.getAllActiveJointValue();
-    set_angle.clear();
-    for (int8_t index = 0; index < _manipulator.getDOF(); index++)
-      set_angle.push_back(_manipulator.getAllActiveJointValue().at(index) + angle_changed(index));
-    _manipulator.setAllActiveJointValue(set_angle);
-    forwardKinematics(&_manipulator);
-    ////////////////////////////////////////
+void ChainFKKernel::solve(const double * const *joint_value, uint32_t size, double *x, double *y, double *z)
+{
+  uint32_t begin = 0;
 
-    //////////////checking dx///////////////
-    position_changed = RM_MATH::positionDifference(target_pose.position, _manipulator.getComponentPositionFromWorld(tool_name));
-    new_Ek = position_changed.transpose() * We * position_changed;
-    ////////////////////////////////////////
+#if defined(__AVX2__)
+  const __m256d offset_y = _mm256_set1_pd(offset_y_);
 
-    /////////////////////////////debug/////////////////////////////////
-    #if defined(KINEMATICS_DEBUG)
-    present_position = _manipulator.getComponentPositionFromWorld(tool_name);
-    present_orientation = _manipulator.getComponentOrientationFromWorld(tool_name);
-    present_orientation_rpy = RM_MATH::convertRotationToRPY(present_orientation);
-    for(int t=0; t<3; t++)
-      debug_present_pose(t) = present_position(t);
-    for(int t=0; t<3; t++)
-      debug_present_pose(t+3) = present_orientation_rpy(t);
-    RM_LOG::WARN("iter : ", count,0);
-    RM_LOG::WARN("Ek : ", new_Ek*1000000000000);
-    RM_LOG::PRINTLN("tar_pose");
-    RM_LOG::PRINTLN_VECTOR(debug_target_pose,16);
-    RM_LOG::PRINTLN("pre_pose");
-    RM_LOG::PRINTLN_VECTOR(debug_present_pose,16);
-    RM_LOG::PRINTLN("delta_pose");
-    RM_LOG::PRINTLN_VECTOR(debug_target_pose-debug_present_pose,16);
-    #endif
-    ////////////////////////////debug//////////////////////////////////
+  for (; begin + 4 <= size; begin += 4)
+  {
+    // arm plane (r : horizontal, h : vertical) after joint1
+    __m256d plane_r = _mm256_set1_pd(offset_x_[0]);
+    __m256d plane_h = _mm256_set1_pd(offset_z_[0]);
+    __m256d pitch = _mm256_setzero_pd();
+    __m256d sin_q, cos_q;
 
-    if (new_Ek < 1E-12)
+    for (int8_t index = 1; index < dof_; index++)
     {
-      /////////////////////////////debug/////////////////////////////////
-      #if defined(KINEMATICS_DEBUG)
-      RM_LOG::WARN("iter : ", count,0);
-      RM_LOG::WARN("Ek : ", new_Ek*1000000000000);
-      RM_LOG::ERROR("IK Success");
-      RM_LOG::PRINTLN("------------------------------------");
-      #endif
-      //////////////////////////debug//////////////////////////////////
-      *goal_joint_value = _manipulator.getAllActiveJointValue();
-      return true;
+      pitch = _mm256_add_pd(pitch, _mm256_loadu_pd(joint_value[index] + begin));
+      sincos4(pitch, &sin_q, &cos_q);
+
+      __m256d offset_x = _mm256_set1_pd(offset_x_[index]);
+      __m256d offset_z = _mm256_set1_pd(offset_z_[index]);
+      plane_r = _mm256_add_pd(plane_r, _mm256_add_pd(_mm256_mul_pd(cos_q, offset_x), _mm256_mul_pd(sin_q, offset_z)));
+      plane_h = _mm256_add_pd(plane_h, _mm256_sub_pd(_mm256_mul_pd(cos_q, offset_z), _mm256_mul_pd(sin_q, offset_x)));
     }
-    else if (new_Ek < pre_Ek)
+
+    // joint1 (yaw)
+    sincos4(_mm256_loadu_pd(joint_value[0] + begin), &sin_q, &cos_q);
+    __m256d local[3];
+    local[0] = _mm256_add_pd(_mm256_set1_pd(base_offset_(0)), _mm256_sub_pd(_mm256_mul_pd(cos_q, plane_r), _mm256_mul_pd(sin_q, offset_y)));
+    local[1] = _mm256_add_pd(_mm256_set1_pd(base_offset_(1)), _mm256_add_pd(_mm256_mul_pd(sin_q, plane_r), _mm256_mul_pd(cos_q, offset_y)));
+    local[2] = _mm256_add_pd(_mm256_set1_pd(base_offset_(2)), plane_h);
+
+    // world
+    double *output[3] = {x, y, z};
+    for (int8_t row = 0; row < 3; row++)
     {
-      pre_Ek = new_Ek;
+      __m256d value = _mm256_set1_pd(world_position_(row));
+      for (int8_t col = 0; col < 3; col++)
+        value = _mm256_add_pd(value, _mm256_mul_pd(_mm256_set1_pd(world_orientation_(row, col)), local[col]));
+      _mm256_storeu_pd(output[row] + begin, value);
     }
-    else
+  }
+#endif
+
+  solveScalar(joint_value, begin, size, x, y, z);
+}
+
+void ChainFKKernel::solveScalar(const double * const *joint_value, uint32_t begin, uint32_t end, double *x, double *y, double *z)
+{
+  for (uint32_t num = begin; num < end; num++)
+  {
+    // arm plane (r : horizontal, h : vertical) after joint1
+    double plane_r = offset_x_[0];
+    double plane_h = offset_z_[0];
+    double pitch = 0.0;
+
+    for (int8_t index = 1; index < dof_; index++)
     {
-      present_angle = _manipulator.getAllActiveJointValue();
-      for (int8_t index = 0; index < _manipulator.getDOF(); index++)
-        set_angle.push_back(_manipulator.getAllActiveJointValue().at(index) - (gamma * angle_changed(index)));
-      _manipulator.setAllActiveJointValue(set_angle);
+      pitch += joint_value[index][num];
+      double sin_q = sin(pitch);
+      double cos_q = cos(pitch);
 
-      forwardKinematics(&_manipulator);
+      plane_r += cos_q * offset_x_[index] + sin_q * offset_z_[index];
+      plane_h += cos_q * offset_z_[index] - sin_q * offset_x_[index];
     }
+
+    // joint1 (yaw)
+    double sin_q = sin(joint_value[0][num]);
+    double cos_q = cos(joint_value[0][num]);
+    Eigen::Vector3d local;
+    local << base_offset_(0) + cos_q * plane_r - sin_q * offset_y_,
+             base_offset_(1) + sin_q * plane_r + cos_q * offset_y_,
+             base_offset_(2) + plane_h;
+
+    // world
+    Eigen::Vector3d position = world_orientation_ * local + world_position_;
+    x[num] = position(0);
+    y[num] = position(1);
+    z[num] = position(2);
   }
-  RM_LOG::ERROR("[position_only]fail to solve inverse kinematics (please change the solver)");
-  *goal_joint_value = _manipulator.getAllActiveJointValue();
+}
+
+//-------------------- Reachability Map --------------------//
+
+bool ReachabilityMap::save(STRING file_name, const ReachabilityMapHeader &header, const std::vector<float> &cell)
+{
+#if defined(__OPENCR__)
+  RM_LOG::ERROR("[reachability map]not supported on OpenCR");
   return false;
+#else
+  FILE *file = fopen(file_name.c_str(), "wb");
+  if (file == NULL)
+  {
+    RM_LOG::ERROR("[reachability map]fail to create " + file_name);
+    return false;
+  }
+
+  bool result = (fwrite(&header, sizeof(ReachabilityMapHeader), 1, file) == 1) &&
+                (fwrite(&cell[0], sizeof(float), cell.size(), file) == cell.size());
+  fclose(file);
+
+  if (result == false)
+    RM_LOG::ERROR("[reachability map]fail to write " + file_name);
+  return result;
+#endif
 }
 
-bool Chain::inverseSolverUsingSRJacobian(Manipulator *manipulator, Name tool_name, Pose target_pose, std::vector<double>* goal_joint_value)
+bool ReachabilityMap::load(STRING file_name)
 {
-  //manipulator
-  Manipulator _manipulator = *manipulator;
+#if defined(__OPENCR__)
+  RM_LOG::ERROR("[reachability map]not supported on OpenCR");
+  return false;
+#else
+  unload();
 
-  //solver parameter
-  double lambda = 0.0;
-  const double param = 0.002;
-  const int8_t iteration = 10;
+  int fd = open(file_name.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    RM_LOG::ERROR("[reachability map]fail to open " + file_name);
+    return false;
+  }
 
-  const double gamma = 0.5;             //rollback delta
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) < 0 || (size_t)file_stat.st_size < sizeof(ReachabilityMapHeader))
+  {
+    RM_LOG::ERROR("[reachability map]wrong file " + file_name);
+    close(fd);
+    return false;
+  }
 
-  //sr sovler parameter
-  double wn_pos = 1 / 0.3;
-  double wn_ang = 1 / (2 * M_PI);
-  double pre_Ek = 0.0;
-  double new_Ek = 0.0;
+  void *mapped = mmap(NULL, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED)
+  {
+    RM_LOG::ERROR("[reachability map]fail to map " + file_name);
+    return false;
+  }
 
-  Eigen::MatrixXd We(6, 6);
-  We << wn_pos, 0, 0, 0, 0, 0,
-      0, wn_pos, 0, 0, 0, 0,
-      0, 0, wn_pos, 0, 0, 0,
-      0, 0, 0, wn_ang, 0, 0,
-      0, 0, 0, 0, wn_ang, 0,
-      0, 0, 0, 0, 0, wn_ang;
+  const ReachabilityMapHeader *header = (const ReachabilityMapHeader *)mapped;
+  size_t cell_size = (size_t)header->size[0] * header->size[1] * header->size[2] * (header->dof + 1);
+  if (memcmp(header->magic, "OMRM", 4) != 0 || header->version != REACHABILITY_MAP_VERSION ||
+      (size_t)file_stat.st_size != sizeof(ReachabilityMapHeader) + cell_size * sizeof(float))
+  {
+    RM_LOG::ERROR("[reachability map]wrong file " + file_name);
+    munmap(mapped, file_stat.st_size);
+    return false;
+  }
 
-  Eigen::MatrixXd Wn = Eigen::MatrixXd::Identity(_manipulator.getDOF(), _manipulator.getDOF());
+  mapped_ = mapped;
+  mapped_size_ = file_stat.st_size;
+  header_ = header;
+  cell_ = (const float *)((const char *)mapped + sizeof(ReachabilityMapHeader));
+  return true;
+#endif
+}
 
-  //jacobian
-  Eigen::MatrixXd jacobian = Eigen::MatrixXd::Identity(6, _manipulator.getDOF());
-  Eigen::MatrixXd sr_jacobian = Eigen::MatrixXd::Identity(_manipulator.getDOF(), _manipulator.getDOF());
+void ReachabilityMap::unload()
+{
+#if !defined(__OPENCR__)
+  if (mapped_ != NULL)
+    munmap(mapped_, mapped_size_);
+#endif
+  mapped_ = NULL;
+  mapped_size_ = 0;
+  header_ = NULL;
+  cell_ = NULL;
+}
 
-  //delta parameter
-  Eigen::VectorXd pose_changed = Eigen::VectorXd::Zero(6);
-  Eigen::VectorXd angle_changed = Eigen::VectorXd::Zero(_manipulator.getDOF());    //delta angle (dq)
-  Eigen::VectorXd gerr(_manipulator.getDOF());
+const float *ReachabilityMap::findSeed(Eigen::Vector3d position)
+{
+  if (header_ == NULL)
+    return NULL;
 
-  //angle parameter
-  std::vector<double> present_angle;                                               //angle (q)
-  std::vector<double> set_angle;                                                   //set angle (q + dq)
+  uint32_t index[3];
+  for (int8_t axis = 0; axis < 3; axis++)
+  {
+    double cell = floor((position(axis) - header_->min[axis]) / header_->resolution);
+    if (cell < 0.0 || cell >= header_->size[axis])
+      return NULL;
+    index[axis] = (uint32_t)cell;
+  }
 
-  ////////////////////////////solving//////////////////////////////////
+  const float *cell = cell_ + ((size_t)(index[2] * header_->size[1] + index[1]) * header_->size[0] + index[0]) * (header_->dof + 1);
+  return (cell[0] > 0.5f) ? cell + 1 : NULL;
+}
 
-  forwardKinematics(&_manipulator);
-  //////////////checking dx///////////////
-  pose_changed = RM_MATH::poseDifference(target_pose.position, _manipulator.getComponentPositionFromWorld(tool_name), target_pose.orientation, _manipulator.getComponentOrientationFromWorld(tool_name));
-  pre_Ek = pose_changed.transpose() * We * pose_changed;
-  ///////////////////////////////////////
+//-------------------- Workspace Envelope --------------------//
 
-  /////////////////////////////debug/////////////////////////////////
-  #if defined(KINEMATICS_DEBUG)
-  Eigen::Vector3d target_orientation_rpy = RM_MATH::convertRotationToRPY(target_pose.orientation);
-  Eigen::VectorXd debug_target_pose(6);
-  for(int t=0; t<3; t++)
-    debug_target_pose(t) = target_pose.position(t);
-  for(int t=0; t<3; t++)
-    debug_target_pose(t+3) = target_orientation_rpy(t);
+bool WorkspaceEnvelope::build(IKWorkspace *workspace, double distance_resolution, double angle_resolution)
+{
+  dof_ = 0;
+  const int8_t dof = workspace->getDOF();
+  const Eigen::Vector3d z_axis = RM_MATH::makeVector3(0.0, 0.0, 1.0);
+  const Eigen::Vector3d y_axis = RM_MATH::makeVector3(0.0, 1.0, 0.0);
+
+  bool is_planar = (dof >= 2) && (workspace->getAxis(0) - z_axis).norm() < 1E-6;
+  for (int8_t index = 1; index < dof; index++)
+    is_planar = is_planar && ((workspace->getAxis(index) - y_axis).norm() < 1E-6);
+  for (int8_t index = 1; index <= dof && is_planar; index++)
+    is_planar = fabs(workspace->getRelativePosition(index)(1)) < 1E-9;
+
+  if (is_planar == false)
+  {
+    RM_LOG::ERROR("[workspace envelope]the chain is not a yaw joint with planar pitch joints");
+    return false;
+  }
 
-  Eigen::Vector3d present_position = _manipulator.getComponentPositionFromWorld(tool_name);
-  Eigen::MatrixXd present_orientation = _manipulator.getComponentOrientationFromWorld(tool_name);
-  Eigen::Vector3d present_orientation_rpy = RM_MATH::convertRotationToRPY(present_orientation);
-  Eigen::VectorXd debug_present_pose(6);
-  for(int t=0; t<3; t++)
-    debug_present_pose(t) = present_position(t);
-  for(int t=0; t<3; t++)
-    debug_present_pose(t+3) = present_orientation_rpy(t);
+  //////////////grid//////////////
+  max_reach_ = 0.0;
+  for (int8_t index = 2; index <= dof; index++)
+    max_reach_ += sqrt(pow(workspace->getRelativePosition(index)(0), 2) + pow(workspace->getRelativePosition(index)(2), 2));
+
+  joint2_min_ = std::max(workspace->getJointMin(1), -M_PI);
+  joint2_max_ = std::min(workspace->getJointMax(1), M_PI);
+
+  // joints sampled with steps moving the tool by a distance resolution at most,
+  // so every reachable position is within (sampled joints / 2) * resolution of a sample
+  const int8_t sample_size = dof - 2;
+  const double step = distance_resolution / std::max(max_reach_, distance_resolution);
+  const double radius = 0.5 * sample_size * distance_resolution + 1E-9;
+
+  distance_resolution_ = distance_resolution;
+  angle_size_ = (uint32_t)ceil(2.0 * M_PI / angle_resolution);
+  angle_resolution_ = 2.0 * M_PI / angle_size_;
+  distance_size_ = (uint32_t)ceil((max_reach_ + radius) / distance_resolution_) + 1;
+  cell_.assign((size_t)distance_size_ * angle_size_, 0);
+
+  std::vector<double> sample_min(sample_size), sample_step(sample_size);
+  std::vector<uint32_t> sample_count(sample_size), sample_index(sample_size, 0);
+  for (int8_t sample = 0; sample < sample_size; sample++)
+  {
+    sample_min.at(sample) = std::max(workspace->getJointMin(sample + 2), -M_PI);
+    double range = std::min(workspace->getJointMax(sample + 2), M_PI) - sample_min.at(sample);
+    sample_count.at(sample) = (uint32_t)ceil(range / step) + 1;
+    sample_step.at(sample) = (sample_count.at(sample) > 1) ? range / (sample_count.at(sample) - 1) : 0.0;
+  }
 
-  RM_LOG::PRINTLN("------------------------------------");
-  RM_LOG::WARN("iter : first");
-  RM_LOG::WARN("Ek : ", pre_Ek*1000000000000);
-  RM_LOG::PRINTLN("tar_pose");
-  RM_LOG::PRINTLN_VECTOR(debug_target_pose,16);
-  RM_LOG::PRINTLN("pre_pose");
-  RM_LOG::PRINTLN_VECTOR(debug_present_pose,16);
-  RM_LOG::PRINTLN("delta_pose");
-  RM_LOG::PRINTLN_VECTOR(debug_target_pose-debug_present_pose,16);
-  #endif
-  ////////////////////////////debug//////////////////////////////////
+  //////////////tool from joint2 of every sample (joint2 at 0)//////////////
+  while (true)
+  {
+    double plane_r = 0.0, plane_z = 0.0, pitch = 0.0;
+    for (int8_t index = 2; index <= dof; index++)
+    {
+      const Eigen::Vector3d &offset = workspace->getRelativePosition(index);
+      plane_r += offset(0) * cos(pitch) + offset(2) * sin(pitch);
+      plane_z += -offset(0) * sin(pitch) + offset(2) * cos(pitch);
+      if (index < dof)
+        pitch += sample_min.at(index - 2) + sample_index.at(index - 2) * sample_step.at(index - 2);
+    }
+    mark(sqrt(plane_r * plane_r + plane_z * plane_z), atan2(plane_z, plane_r), radius);
 
-  //////////////////////////solving loop///////////////////////////////
-  for (int8_t count = 0; count < iteration; count++)
+    int8_t sample = 0;
+    while (sample < sample_size && ++sample_index.at(sample) == sample_count.at(sample))
+      sample_index.at(sample++) = 0;
+    if (sample == sample_size)
+      break;
+  }
+
+  dof_ = dof;
+  return true;
+}
+
+void WorkspaceEnvelope::mark(double distance, double angle, double radius)
+{
+  int32_t distance_begin = std::max((int32_t)floor((distance - radius) / distance_resolution_), (int32_t)0);
+  int32_t distance_end = std::min((int32_t)floor((distance + radius) / distance_resolution_), (int32_t)distance_size_ - 1);
+
+  // every position within the radius is seen from joint2 within this angle of the sample
+  int32_t angle_begin = 0, angle_end = angle_size_ - 1;
+  if (radius < distance)
   {
-    //////////solve using jacobian//////////
-    jacobian = this->jacobian(&_manipulator, tool_name);
-    lambda = pre_Ek + param;
+    double half_angle = asin(radius / distance);
+    angle_begin = (int32_t)floor((angle - half_angle + M_PI) / angle_resolution_);
+    angle_end = (int32_t)floor((angle + half_angle + M_PI) / angle_resolution_);
+  }
 
-    sr_jacobian = (jacobian.transpose() * We * jacobian) + (lambda * Wn);     //calculate sr_jacobian (J^T*we*J + lamda*Wn)
-    gerr = jacobian.transpose() * We * pose_changed;                          //calculate gerr (J^T*we) dx
+  for (int32_t distance_index = distance_begin; distance_index <= distance_end; distance_index++)
+  {
+    uint8_t *row = &cell_[(size_t)distance_index * angle_size_];
+    for (int32_t angle_index = angle_begin; angle_index <= angle_end; angle_index++)
+      row[(angle_index % (int32_t)angle_size_ + angle_size_) % angle_size_] = 1;
+  }
+}
 
-    ColPivHouseholderQR<Eigen::MatrixXd> dec(sr_jacobian);                    //solving (get dq)
-    angle_changed = dec.solve(gerr);                                          //(J^T*we) * dx = (J^T*we*J + lamda*Wn) * dq
+bool WorkspaceEnvelope::isReachable(double plane_r, double plane_z)
+{
+  if (dof_ == 0)
+    return true;
 
-    present_angle = _manipulator.getAllActiveJointValue();
-    set_angle.clear();
-    for (int8_t index = 0; index < _manipulator.getDOF(); index++)
-      set_angle.push_back(present_angle.at(index) + angle_changed(index));
-    _manipulator.setAllActiveJointValue(set_angle);
-    forwardKinematics(&_manipulator);
-    ////////////////////////////////////////
+  double distance_cell = floor(sqrt(plane_r * plane_r + plane_z * plane_z) / distance_resolution_);
+  if (distance_cell >= distance_size_)
+    return false;
 
-    //////////////checking dx///////////////
-    pose_changed = RM_MATH::poseDifference(target_pose.position, _manipulator.getComponentPositionFromWorld(tool_name), target_pose.orientation, _manipulator.getComponentOrientationFromWorld(tool_name));
-    new_Ek = pose_changed.transpose() * We * pose_changed;
-    ////////////////////////////////////////
+  // joint2 turns the tool down by its value : angle at joint2 = 0 is the goal angle + joint2
+  const double angle = atan2(plane_z, plane_r);
+  int32_t angle_begin = 0, angle_end = angle_size_ - 1;
+  if (joint2_max_ - joint2_min_ < 2.0 * M_PI)
+  {
+    angle_begin = (int32_t)floor((angle + joint2_min_ + M_PI) / angle_resolution_);
+    angle_end = (int32_t)floor((angle + joint2_max_ + M_PI) / angle_resolution_);
+  }
 
-    /////////////////////////////debug/////////////////////////////////
-    #if defined(KINEMATICS_DEBUG)
-    present_position = _manipulator.getComponentPositionFromWorld(tool_name);
-    present_orientation = _manipulator.getComponentOrientationFromWorld(tool_name);
-    present_orientation_rpy = RM_MATH::convertRotationToRPY(present_orientation);
-    for(int t=0; t<3; t++)
-      debug_present_pose(t) = present_position(t);
-    for(int t=0; t<3; t++)
-      debug_present_pose(t+3) = present_orientation_rpy(t);
-    RM_LOG::WARN("iter : ", count,0);
-    RM_LOG::WARN("Ek : ", new_Ek*1000000000000);
-    RM_LOG::PRINTLN("tar_pose");
-    RM_LOG::PRINTLN_VECTOR(debug_target_pose,16);
-    RM_LOG::PRINTLN("pre_pose");
-    RM_LOG::PRINTLN_VECTOR(debug_present_pose,16);
-    RM_LOG::PRINTLN("delta_pose");
-    RM_LOG::PRINTLN_VECTOR(debug_target_pose-debug_present_pose,16);
-    #endif
-    ////////////////////////////debug//////////////////////////////////
+  const uint8_t *row = &cell_[(size_t)distance_cell * angle_size_];
+  int32_t angle_index = (angle_begin % (int32_t)angle_size_ + angle_size_) % angle_size_;
+  for (int32_t count = angle_begin; count <= angle_end; count++)
+  {
+    if (row[angle_index])
+      return true;
+    if (++angle_index == (int32_t)angle_size_)
+      angle_index = 0;
+  }
+  return false;
+}
+
+//-------------------- IK Thread Pool --------------------//
+
+#if !defined(__OPENCR__)
+void IKThreadPool::start(uint8_t thread_size)
+{
+  stop();
+
+  stop_ = false;
+  for (uint8_t index = 0; index < thread_size; index++)
+    thread_.push_back(std::thread(&IKThreadPool::workerLoop, this));
+}
+
+void IKThreadPool::stop()
+{
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  job_condition_.notify_all();
+
+  for (uint8_t index = 0; index < thread_.size(); index++)
+    thread_.at(index).join();
+  thread_.clear();
+}
+
+bool IKThreadPool::run(uint32_t job_size, const std::function<void(uint32_t)> &job)
+{
+  // another solving thread has the workers, the caller runs its jobs by itself instead of waiting
+  std::unique_lock<std::mutex> run_lock(run_mutex_, std::try_to_lock);
+  if (run_lock.owns_lock() == false)
+    return false;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  job_ = job;
+  job_size_ = job_size;
+  next_job_ = 0;
+  done_job_ = 0;
+  job_condition_.notify_all();
+
+  // the caller takes jobs as well
+  while (next_job_ < job_size_)
+    runNextJob(lock);
+
+  while (done_job_ < job_size_)
+    done_condition_.wait(lock);
+  job_size_ = 0;
+  next_job_ = 0;
+  return true;
+}
+
+void IKThreadPool::workerLoop()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true)
+  {
+    while (stop_ == false && next_job_ >= job_size_)
+      job_condition_.wait(lock);
+
+    if (stop_)
+      return;
+    runNextJob(lock);
+  }
+}
+
+void IKThreadPool::runNextJob(std::unique_lock<std::mutex> &lock)
+{
+  uint32_t index = next_job_++;
+
+  lock.unlock();
+  job_(index);
+  lock.lock();
+
+  if (++done_job_ == job_size_)
+    done_condition_.notify_all();
+}
+#endif
+
+//-------------------- Chain --------------------//
+
+static double getMonotonicTime() // us
+{
+#if defined(__OPENCR__)
+  return (double)micros();
+#else
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec * 1000000.0 + time.tv_nsec / 1000.0;
+#endif
+}
+
+static std::atomic<uint32_t> chain_count(0);
+
+static const char *inverse_solver_name[] = {"", "position_only_inverse", "sr_inverse", "chain_custum_inverse_kinematics",
+                                            "normal_inverse", "analytic_inverse"};
+
+Chain::Chain()
+  :id_(chain_count++),
+   inverse_solver_(INVERSE_SOLVER_UNKNOWN),
+   description_version_(0),
+   envelope_state_(ENVELOPE_NONE),
+   fk_manipulator_(NULL),
+   fk_cache_valid_(false)
+{
+  fk_busy_.clear();
+
+  ik_options_.iteration = 10;
+  ik_options_.tolerance = 1E-12;
+  ik_options_.jacobian_tolerance = 1E-6;
+  ik_options_.jacobian_step = 0.7;
+  ik_options_.damping = 0.002;
+  ik_options_.damping_gain = 1.0;
+  ik_options_.rollback_gamma = 0.5;
+  ik_options_.time_budget = 0.0;
+  ik_options_.approximate_tolerance = 0.0;
+  ik_options_.clamp_joint_limit = false;
+  ik_options_.multi_start = false;
+  ik_options_.thread = 0;
+  ik_options_.rate_damping = 1E-4;
+  ik_options_.rate_orientation_weight = 1E-3;
+  ik_options_.rate_max_joint_velocity = 1.5;
+  ik_options_.workspace_min_radius = 0.01;
+
+#if defined(__OPENCR__)
+  initContext(&context_);
+#endif
+}
+
+IKContext *Chain::getContext()
+{
+#if defined(__OPENCR__)
+  return &context_;
+#else
+  // one per thread and chain, kept until the thread exits
+  static thread_local std::map<uint32_t, IKContext> context;
+
+  std::map<uint32_t, IKContext>::iterator it = context.find(id_);
+  if (it == context.end())
+  {
+    it = context.insert(std::make_pair(id_, IKContext())).first;
+    initContext(&it->second);
+  }
+  return &it->second;
+#endif
+}
+
+void Chain::initContext(IKContext *context)
+{
+  context->description_version = description_version_.load(std::memory_order_acquire);
+  context->workspace.clear();
+  context->deadline = 0.0;
+
+  context->result.success = false;
+  context->result.error = 0.0;
+  context->result.iteration = 0;
+  context->result.time = 0.0;
+  context->result.exit_reason = IK_NO_SOLUTION;
+  context->result.approximate = false;
+}
+
+bool Chain::loadWorkspace(IKContext *context, Manipulator *manipulator, Name tool_name)
+{
+  uint32_t description_version = description_version_.load(std::memory_order_acquire);
+  if (context->description_version != description_version)
+  {
+    context->workspace.clear(); // rebuilt with the new limits or plan
+    context->description_version = description_version;
+  }
+
+  return context->workspace.load(manipulator, tool_name, &joint_limit_, getState(manipulator));
+}
+
+void Chain::updatePassiveJointValue(Manipulator *manipulator){}
+
+Eigen::MatrixXd Chain::jacobian(Manipulator *manipulator, Name tool_name)
+{
+  Eigen::MatrixXd jacobian = Eigen::MatrixXd::Identity(6, manipulator->getDOF());
+
+  Eigen::Vector3d joint_axis = ZERO_VECTOR;
+
+  Eigen::Vector3d position_changed = ZERO_VECTOR;
+  Eigen::Vector3d orientation_changed = ZERO_VECTOR;
+  Eigen::VectorXd pose_changed = Eigen::VectorXd::Zero(6);
 
-    if (new_Ek < 1E-12)
+  int8_t index = 0;
+  Name my_name =  manipulator->getWorldChildName();
+
+  for (int8_t size = 0; size < manipulator->getDOF(); size++)
+  {
+    Name parent_name = manipulator->getComponentParentName(my_name);
+    if (parent_name == manipulator->getWorldName())
     {
-      /////////////////////////////debug/////////////////////////////////
-      #if defined(KINEMATICS_DEBUG)
-      RM_LOG::WARN("iter : ", count,0);
-      RM_LOG::WARN("Ek : ", new_Ek*1000000000000);
-      RM_LOG::ERROR("Success");
-      RM_LOG::PRINTLN("------------------------------------");
-      #endif
-      //////////////////////////debug//////////////////////////////////
-      *goal_joint_value = _manipulator.getAllActiveJointValue();
-      return true;
+      joint_axis = manipulator->getWorldOrientation() * manipulator->getAxis(my_name);
     }
-    else if (new_Ek < pre_Ek)
+    else
     {
-      pre_Ek = new_Ek;
+      joint_axis = manipulator->getComponentOrientationFromWorld(parent_name) * manipulator->getAxis(my_name);
+    }
+
+    position_changed = RM_MATH::skewSymmetricMatrix(joint_axis) *
+                       (manipulator->getComponentPositionFromWorld(tool_name) - manipulator->getComponentPositionFromWorld(my_name));
+    orientation_changed = joint_axis;
+
+    pose_changed << position_changed(0),
+        position_changed(1),
+        position_changed(2),
+        orientation_changed(0),
+        orientation_changed(1),
+        orientation_changed(2);
+
+    jacobian.col(index) = pose_changed;
+    index++;
+    my_name = manipulator->getComponentChildName(my_name).at(0); // Get Child name which has active joint
+  }
+  return jacobian;
+}
+
+void Chain::forwardKinematics(Manipulator *manipulator)
+{
+  if (fk_link_.size() == 0)
+    buildForwardKinematicsPlan(manipulator);
+
+  forwardSolverUsingPlan(manipulator);
+}
+
+bool Chain::inverseKinematics(Manipulator *manipulator, Name tool_name, Pose target_pose, std::vector<double> *goal_joint_value)
+{
+  const uint8_t inverse_solver = inverse_solver_.load(std::memory_order_relaxed);
+
+  if (reachability_map_.isLoaded() || ik_options_.multi_start)
+    return solveInverse(manipulator, tool_name, target_pose, goal_joint_value, &Chain::solveInverseFromSeeds,
+                        "fail to solve inverse kinematics (out of reachability map or please change the solver)", inverse_solver_name[inverse_solver]);
+
+  if(inverse_solver == INVERSE_SOLVER_POSITION_ONLY)
+    return inverseSolverUsingPositionOnlySRJacobian(manipulator, tool_name, target_pose, goal_joint_value);
+  else if (inverse_solver == INVERSE_SOLVER_SR)
+    return inverseSolverUsingSRJacobian(manipulator, tool_name, target_pose, goal_joint_value);
+  else if(inverse_solver == INVERSE_SOLVER_CHAIN_CUSTOM)
+    return chainCustomInverseKinematics(manipulator, tool_name, target_pose, goal_joint_value);
+  else if(inverse_solver == INVERSE_SOLVER_NORMAL)
+    return inverseSolverUsingJacobian(manipulator, tool_name, target_pose, goal_joint_value);
+  else if(inverse_solver == INVERSE_SOLVER_ANALYTIC)
+    return analyticInverseKinematics(manipulator, tool_name, target_pose, goal_joint_value);
+  else
+  {
+    RM_LOG::ERROR("Wrong inverse solver name (please change the solver)");
+  }
+  return false;
+}
+
+void Chain::buildForwardKinematicsPlan(Manipulator *manipulator)
+{
+  fk_link_.clear();
+  fk_world_position_ = manipulator->getWorldPosition();
+  fk_world_orientation_ = manipulator->getWorldOrientation();
+
+  ForwardKinematicsLink link;
+  link.name = manipulator->getWorldChildName();
+  link.parent = -1;
+  link.axis = manipulator->getAxis(link.name);
+  link.axis_type = getAxisType(link.axis);
+  link.relative_position = manipulator->getComponentRelativePositionFromParent(link.name);
+  link.value = NAN;
+  link.sin_value = 0.0;
+  link.cos_value = 1.0;
+  fk_link_.push_back(link);
+
+  // breadth first, so every parent is placed before its children
+  for (int8_t index = 0; index < (int8_t)fk_link_.size(); index++)
+  {
+    std::vector<Name> child_name = manipulator->getComponentChildName(fk_link_.at(index).name);
+    for (uint8_t num = 0; num < child_name.size(); num++)
+    {
+      link.name = child_name.at(num);
+      link.parent = index;
+      link.axis = manipulator->getAxis(link.name);
+      link.axis_type = getAxisType(link.axis);
+      link.relative_position = manipulator->getComponentRelativePositionFromParent(link.name);
+      fk_link_.push_back(link);
+    }
+  }
+
+  fk_position_.resize(fk_link_.size());
+  fk_orientation_.resize(fk_link_.size());
+  fk_dirty_.resize(fk_link_.size());
+  fk_manipulator_ = manipulator;
+  fk_cache_valid_ = false;
+
+  std::vector<Name> link_name(fk_link_.size());
+  for (uint8_t index = 0; index < fk_link_.size(); index++)
+    link_name.at(index) = fk_link_.at(index).name;
+  state_.setName(link_name);
+  description_version_++;
+}
+
+void Chain::forwardSolverUsingPlan(Manipulator *manipulator)
+{
+  // other manipulators (copies), or the plan manipulator while another thread updates the cache,
+  // get the full pass on the context of the calling thread and leave the cache alone
+  if (manipulator == fk_manipulator_ && fk_busy_.test_and_set(std::memory_order_acquire) == false)
+  {
+    forwardSolverUsingCache(manipulator);
+    fk_busy_.clear(std::memory_order_release);
+  }
+  else
+  {
+    forwardSolverUsingContext(manipulator, getContext());
+  }
+}
+
+void Chain::forwardSolverUsingCache(Manipulator *manipulator)
+{
+  const int8_t link_size = fk_link_.size();
+  const bool incremental = fk_cache_valid_;
+  fk_cache_valid_ = true;
+
+  double state_value[CHAIN_STATE_SIZE];
+  for (int8_t index = 0; index < link_size; index++)
+  {
+    ForwardKinematicsLink &link = fk_link_[index];
+    double value = manipulator->getValue(link.name);
+    if (index < CHAIN_STATE_SIZE)
+      state_value[index] = value;
+
+    // dirty when the joint or anything upstream moved
+    bool dirty = (incremental == false || (link.parent >= 0 && fk_dirty_[link.parent]));
+    if (value != link.value)
+    {
+      link.value = value;
+      link.sin_value = sin(value);
+      link.cos_value = cos(value);
+      dirty = true;
     }
+    fk_dirty_[index] = dirty;
+    if (dirty == false)
+      continue;
+
+    const Eigen::Vector3d &parent_position_to_world = (link.parent < 0) ? fk_world_position_ : fk_position_[link.parent];
+    const Eigen::Matrix3d &parent_orientation_to_world = (link.parent < 0) ? fk_world_orientation_ : fk_orientation_[link.parent];
+
+    fk_position_[index] = parent_orientation_to_world * link.relative_position + parent_position_to_world;
+    rotateAboutAxis(parent_orientation_to_world, link.axis_type, link.axis, link.sin_value, link.cos_value, &fk_orientation_[index]);
+  }
+
+  for (int8_t index = 0; index < link_size; index++)
+  {
+    if (fk_dirty_[index] == false)
+      continue;
+
+    manipulator->setComponentPositionFromWorld(fk_link_[index].name, fk_position_[index]);
+    manipulator->setComponentOrientationFromWorld(fk_link_[index].name, fk_orientation_[index]);
+  }
+
+  if (state_.getSize() == link_size)
+    state_.write(state_value);
+}
+
+void Chain::forwardSolverUsingContext(Manipulator *manipulator, IKContext *context)
+{
+  const int8_t link_size = fk_link_.size();
+  context->fk_position.resize(link_size);
+  context->fk_orientation.resize(link_size);
+
+  for (int8_t index = 0; index < link_size; index++)
+  {
+    const ForwardKinematicsLink &link = fk_link_[index];
+    double value = manipulator->getValue(link.name);
+
+    const Eigen::Vector3d &parent_position_to_world = (link.parent < 0) ? fk_world_position_ : context->fk_position[link.parent];
+    const Eigen::Matrix3d &parent_orientation_to_world = (link.parent < 0) ? fk_world_orientation_ : context->fk_orientation[link.parent];
+
+    context->fk_position[index] = parent_orientation_to_world * link.relative_position + parent_position_to_world;
+    rotateAboutAxis(parent_orientation_to_world, link.axis_type, link.axis, sin(value), cos(value), &context->fk_orientation[index]);
+  }
+
+  for (int8_t index = 0; index < link_size; index++)
+  {
+    manipulator->setComponentPositionFromWorld(fk_link_[index].name, context->fk_position[index]);
+    manipulator->setComponentOrientationFromWorld(fk_link_[index].name, context->fk_orientation[index]);
+  }
+}
+
+void Chain::publishState(Manipulator *manipulator)
+{
+  const int8_t link_size = fk_link_.size();
+  if (manipulator != fk_manipulator_ || state_.getSize() != link_size || fk_busy_.test_and_set(std::memory_order_acquire))
+    return;
+
+  double state_value[CHAIN_STATE_SIZE];
+  for (int8_t index = 0; index < link_size; index++)
+    state_value[index] = manipulator->getValue(fk_link_[index].name);
+  state_.write(state_value);
+
+  fk_busy_.clear(std::memory_order_release);
+}
+
+void Chain::forwardSolverUsingChainRule(Manipulator *manipulator, Name component_name)
+{
+  Name my_name = component_name;
+  Name parent_name = manipulator->getComponentParentName(my_name);
+  int8_t number_of_child = manipulator->getComponentChildName(my_name).size();
+
+  Eigen::Vector3d parent_position_to_world, my_position_to_world;
+  Eigen::Matrix3d parent_orientation_to_world, my_orientation_to_world;
+
+  if (parent_name == manipulator->getWorldName())
+  {
+    parent_position_to_world = manipulator->getWorldPosition();
+    parent_orientation_to_world = manipulator->getWorldOrientation();
+  }
+  else
+  {
+    parent_position_to_world = manipulator->getComponentPositionFromWorld(parent_name);
+    parent_orientation_to_world = manipulator->getComponentOrientationFromWorld(parent_name);
+  }
+
+  my_position_to_world = parent_orientation_to_world * manipulator->getComponentRelativePositionFromParent(my_name) + parent_position_to_world;
+  my_orientation_to_world = parent_orientation_to_world * RM_MATH::rodriguesRotationMatrix(manipulator->getAxis(my_name), manipulator->getValue(my_name));
+
+  manipulator->setComponentPositionFromWorld(my_name, my_position_to_world);
+  manipulator->setComponentOrientationFromWorld(my_name, my_orientation_to_world);
+
+  for (int8_t index = 0; index < number_of_child; index++)
+  {
+    Name child_name = manipulator->getComponentChildName(my_name).at(index);
+    forwardSolverUsingChainRule(manipulator, child_name);
+  }
+}
+
+bool Chain::inverseSolverUsingJacobian(Manipulator *manipulator, Name tool_name, Pose target_pose, std::vector<double>* goal_joint_value)
+{
+  return solveInverse(manipulator, tool_name, target_pose, goal_joint_value, &Chain::solveJacobianInverse, NULL);
+}
+
+bool Chain::inverseSolverUsingPositionOnlySRJacobian(Manipulator *manipulator, Name tool_name, Pose target_pose, std::vector<double>* goal_joint_value)
+{
+  return solveInverse(manipulator, tool_name, target_pose, goal_joint_value, &Chain::solvePositionOnlySRInverse, "[position_only]fail to solve inverse kinematics (please change the solver)");
+}
+
+bool Chain::inverseSolverUsingSRJacobian(Manipulator *manipulator, Name tool_name, Pose target_pose, std::vector<double>* goal_joint_value)
+{
+  return solveInverse(manipulator, tool_name, target_pose, goal_joint_value, &Chain::solveSRInverse, "[sr]fail to solve inverse kinematics (please change the solver)");
+}
+
+bool Chain::chainCustomInverseKinematics(Manipulator *manipulator, Name tool_name, Pose target_pose, std::vector<double> *goal_joint_value)
+{
+  return solveInverse(manipulator, tool_name, target_pose, goal_joint_value, &Chain::solveChainCustomInverse, "[OpenManipulator Chain Custom]fail to solve inverse kinematics");
+}
+
+bool Chain::solveInverse(Manipulator *manipulator, Name tool_name, Pose target_pose, std::vector<double>* goal_joint_value, InverseSolver solver,
+                         const char *fail_log, const char *solver_name)
+{
+  IKContext *context = getContext();
+  IKWorkspace *workspace = &context->workspace;
+  IKResult *result = &context->result;
+
+  double start_time = getMonotonicTime();
+  result->success = false;
+  result->approximate = false;
+  if (loadWorkspace(context, manipulator, tool_name) == false)
+    return false;
+
+  workspace->setTimeLimit(start_time, context->deadline);
+  (this->*solver)(workspace, target_pose, result);
+  result->time = getMonotonicTime() - start_time;
+
+  // the message is only built on a failure
+  if (result->success == false && fail_log != NULL)
+  {
+    if (solver_name != NULL)
+      RM_LOG::ERROR("[" + STRING(solver_name) + "]" + fail_log);
+    else
+      RM_LOG::ERROR(fail_log);
+  }
+
+  workspace->getAllJointValue(&result->joint_value);
+  *goal_joint_value = result->joint_value;
+  return result->success;
+}
+
+bool Chain::isTimeOut(IKWorkspace *workspace)
+{
+  const double deadline = workspace->getDeadline();
+  if (ik_options_.time_budget <= 0.0 && deadline <= 0.0)
+    return false;
+
+  double present_time = getMonotonicTime();
+  return ((ik_options_.time_budget > 0.0 && present_time - workspace->getStartTime() > ik_options_.time_budget) ||
+          (deadline > 0.0 && present_time > deadline));
+}
+
+void Chain::setDeadline(double deadline)
+{
+  getContext()->deadline = deadline;
+}
+
+bool Chain::inverseKinematicsBatch(Manipulator *manipulator, Name tool_name, const std::vector<Pose> &target_pose, const std::vector<std::vector<double> > &seed, std::vector<IKResult> *result)
+{
+  IKContext *context = getContext();
+  IKWorkspace *workspace = &context->workspace;
+
+  result->resize(target_pose.size());
+  if (loadWorkspace(context, manipulator, tool_name) == false)
+    return false;
+
+  const uint8_t dof = workspace->getDOF();
+  std::vector<double> warm_start;
+  workspace->getAllJointValue(&warm_start);
+
+  uint32_t fail_count = 0;
+  for (uint32_t index = 0; index < target_pose.size(); index++)
+  {
+    // given seed first, otherwise start from the previous solution
+    if (index < seed.size() && seed.at(index).size() == dof)
+      workspace->setAllJointValue(seed.at(index));
+    else
+      workspace->setAllJointValue(warm_start);
+
+    IKResult *_result = &result->at(index);
+    double start_time = getMonotonicTime();
+    workspace->setTimeLimit(start_time, context->deadline);
+    _result->approximate = false;
+    solveInverseFromSeeds(workspace, target_pose.at(index), _result);
+    workspace->getAllJointValue(&_result->joint_value);
+    _result->time = getMonotonicTime() - start_time;
+
+    if (_result->success)
+      warm_start = _result->joint_value;
     else
+      fail_count++;
+  }
+
+  if (fail_count > 0)
+    RM_LOG::WARN("[batch]fail to solve inverse kinematics : ", (double)fail_count, 0);
+  return (fail_count == 0);
+}
+
+bool Chain::solveInverseOnWorkspace(IKWorkspace *workspace, Pose target_pose, IKResult *result)
+{
+  const uint8_t inverse_solver = inverse_solver_.load(std::memory_order_relaxed);
+
+  if(inverse_solver == INVERSE_SOLVER_POSITION_ONLY)
+    return solvePositionOnlySRInverse(workspace, target_pose, result);
+  else if (inverse_solver == INVERSE_SOLVER_SR)
+    return solveSRInverse(workspace, target_pose, result);
+  else if(inverse_solver == INVERSE_SOLVER_CHAIN_CUSTOM)
+    return solveChainCustomInverse(workspace, target_pose, result);
+  else if(inverse_solver == INVERSE_SOLVER_NORMAL)
+    return solveJacobianInverse(workspace, target_pose, result);
+  else if(inverse_solver == INVERSE_SOLVER_ANALYTIC)
+    return solveAnalyticInverse(workspace, target_pose, result);
+
+  RM_LOG::ERROR("Wrong inverse solver name (please change the solver)");
+  result->success = false;
+  result->error = 0.0;
+  result->iteration = 0;
+  result->exit_reason = IK_WRONG_SOLVER;
+  return false;
+}
+
+bool Chain::solveInverseFromSeeds(IKWorkspace *workspace, Pose target_pose, IKResult *result)
+{
+  if (ik_options_.multi_start)
+    return solveInverseMultiStart(workspace, target_pose, result);
+  else
+    return solveInverseUsingReachabilityMap(workspace, target_pose, result);
+}
+
+bool Chain::solveInverseMultiStart(IKWorkspace *workspace, Pose target_pose, IKResult *result)
+{
+  const int8_t dof = workspace->getDOF();
+  IKContext *context = getContext();
+  std::vector<std::vector<double> > &start_seed = context->start_seed;
+  std::vector<IKWorkspace> &start_workspace = context->start_workspace;
+  std::vector<IKResult> &start_result = context->start_result;
+
+  //////////////seeds : present, mirrored elbow, reachability map//////////////
+  start_seed.resize(3);
+  uint8_t seed_size = 0;
+
+  workspace->getAllJointValue(&start_seed.at(seed_size++));
+  if (mirrorElbow(workspace, &start_seed.at(seed_size)))
+    seed_size++;
+
+  if (reachability_map_.getDOF() == dof)
+  {
+    const float *seed = reachability_map_.findSeed(target_pose.position);
+    if (seed == NULL)
+      return solveInverseUsingReachabilityMap(workspace, target_pose, result); // rejected without iterating
+
+    start_seed.at(seed_size).assign(seed, seed + dof);
+    seed_size++;
+  }
+
+  //////////////solve from every seed//////////////
+  if (start_workspace.size() < seed_size)
+  {
+    start_workspace.resize(seed_size);
+    start_result.resize(seed_size);
+  }
+  for (uint8_t index = 0; index < seed_size; index++)
+  {
+    start_workspace.at(index) = *workspace;
+    start_workspace.at(index).setAllJointValue(start_seed.at(index));
+    start_workspace.at(index).clampJointValue();
+    start_result.at(index).approximate = false;
+  }
+
+#if !defined(__OPENCR__)
+  bool is_run = (thread_pool_.getThreadSize() > 0 &&
+                 thread_pool_.run(seed_size, [this, &start_workspace, &start_result, &target_pose](uint32_t index)
+                                  {solveInverseOnWorkspace(&start_workspace.at(index), target_pose, &start_result.at(index));}));
+#else
+  bool is_run = false;
+#endif
+  if (is_run == false)
+  {
+    for (uint8_t index = 0; index < seed_size; index++)
+      solveInverseOnWorkspace(&start_workspace.at(index), target_pose, &start_result.at(index));
+  }
+
+  //////////////the solution in the limits closest to the present, otherwise the smallest error//////////////
+  int8_t select_index = -1;
+  double select_value = 0.0;
+  bool select_success = false;
+  uint16_t iteration = 0;
+
+  for (uint8_t index = 0; index < seed_size; index++)
+  {
+    IKWorkspace *_workspace = &start_workspace.at(index);
+    bool success = start_result.at(index).success && _workspace->isInJointLimit();
+    iteration += start_result.at(index).iteration;
+
+    double value = start_result.at(index).error;
+    if (success)
     {
-      present_angle = _manipulator.getAllActiveJointValue();
-      for (int8_t index = 0; index < _manipulator.getDOF(); index++)
-        set_angle.push_back(present_angle.at(index) - (gamma * angle_changed(index)));
-      _manipulator.setAllActiveJointValue(set_angle);
+      value = 0.0;
+      for (int8_t joint = 0; joint < dof; joint++)
+        value += pow(_workspace->getJointValue(joint) - start_seed.at(0).at(joint), 2);
+    }
 
-      forwardKinematics(&_manipulator);
+    if (select_index < 0 || (success && select_success == false) || (success == select_success && value < select_value))
+    {
+      select_index = index;
+      select_value = value;
+      select_success = success;
     }
   }
-  RM_LOG::ERROR("[sr]fail to solve inverse kinematics (please change the solver)");
-  *goal_joint_value = _manipulator.getAllActiveJointValue();
+
+  *workspace = start_workspace.at(select_index);
+  result->success = select_success;
+  result->error = start_result.at(select_index).error;
+  result->iteration = iteration;
+  result->exit_reason = start_result.at(select_index).exit_reason;
+  result->approximate = start_result.at(select_index).approximate;
+  return result->success;
+}
+
+bool Chain::mirrorElbow(IKWorkspace *workspace, std::vector<double> *joint_value)
+{
+  // the other elbow of the OpenManipulator Chain with the same tool pose (yaw joint + 3 pitch joints)
+  const Eigen::Vector3d y_axis = RM_MATH::makeVector3(0.0, 1.0, 0.0);
+  if (workspace->getDOF() != 4 || (workspace->getAxis(1) - y_axis).norm() > 1E-6 ||
+      (workspace->getAxis(2) - y_axis).norm() > 1E-6 || (workspace->getAxis(3) - y_axis).norm() > 1E-6)
+    return false;
+
+  Eigen::Vector3d link2 = workspace->getRelativePosition(2);
+  Eigen::Vector3d link3 = workspace->getRelativePosition(3);
+  double link2_length = sqrt(pow(link2(0), 2) + pow(link2(2), 2));
+  double link3_length = sqrt(pow(link3(0), 2) + pow(link3(2), 2));
+  double link2_angle = atan2(link2(2), link2(0));
+  double link3_angle = atan2(link3(2), link3(0));
+
+  workspace->getAllJointValue(joint_value);
+  std::vector<double> &q = *joint_value;
+
+  // link angles on the arm plane, mirrored about the line from joint2 to joint4
+  double link2_plane_angle = link2_angle - q.at(1);
+  double link3_plane_angle = link3_angle - q.at(1) - q.at(2);
+  double wrist_angle = atan2(link2_length * sin(link2_plane_angle) + link3_length * sin(link3_plane_angle),
+                             link2_length * cos(link2_plane_angle) + link3_length * cos(link3_plane_angle));
+
+  double mirror_link2_plane_angle = 2.0 * wrist_angle - link2_plane_angle;
+  double mirror_link3_plane_angle = 2.0 * wrist_angle - link3_plane_angle;
+  if (fabs(sin(mirror_link2_plane_angle - link2_plane_angle)) < 1E-6 && cos(mirror_link2_plane_angle - link2_plane_angle) > 0.0)
+    return false; // straight elbow
+
+  double pitch = q.at(1) + q.at(2) + q.at(3);
+  q.at(1) = link2_angle - mirror_link2_plane_angle;
+  q.at(2) = link3_angle - mirror_link3_plane_angle - q.at(1);
+  q.at(3) = pitch - q.at(1) - q.at(2);
+
+  for (int8_t index = 1; index < 4; index++)
+    q.at(index) = atan2(sin(q.at(index)), cos(q.at(index)));
+  return true;
+}
+
+bool Chain::solveInverseUsingReachabilityMap(IKWorkspace *workspace, Pose target_pose, IKResult *result)
+{
+  if (reachability_map_.getDOF() != workspace->getDOF())
+    return solveInverseOnWorkspace(workspace, target_pose, result);
+
+  const float *seed = reachability_map_.findSeed(target_pose.position);
+  if (seed == NULL)
+  {
+    // out of the workspace : reject without iterating
+    workspace->forward();
+    result->success = false;
+    result->error = poseDifference(target_pose, workspace->getToolPosition(), workspace->getToolOrientation()).norm();
+    result->iteration = 0;
+    result->exit_reason = IK_NO_SOLUTION;
+    return false;
+  }
+
+  // the given seed first to keep the branch, then the seed of the target cell
+  if (solveInverseOnWorkspace(workspace, target_pose, result) || result->exit_reason == IK_TIME_OUT)
+    return result->success;
+
+  uint16_t first_iteration = result->iteration;
+  for (int8_t index = 0; index < workspace->getDOF(); index++)
+    workspace->setJointValue(index, seed[index]);
+
+  solveInverseOnWorkspace(workspace, target_pose, result);
+  result->iteration += first_iteration;
+  return result->success;
+}
+
+bool Chain::solveJacobianInverse(IKWorkspace *workspace, Pose target_pose, IKResult *result)
+{
+  if (workspace->getDOF() == CHAIN_FIXED_DOF)
+    return jacobianInverseSolver<CHAIN_FIXED_DOF>(workspace, target_pose, result);
+  else
+    return jacobianInverseSolver<Eigen::Dynamic>(workspace, target_pose, result);
+}
+
+template <int DOF>
+bool Chain::jacobianInverseSolver(IKWorkspace *workspace, Pose target_pose, IKResult *result)
+{
+  const double lambda = ik_options_.jacobian_step;
+  const uint16_t iteration = ik_options_.iteration;
+
+  //workspace (seeded by the caller)
+  const int8_t dof = workspace->getDOF();
+
+  Eigen::Matrix<double, 6, DOF> jacobian(6, dof);
+  Eigen::ColPivHouseholderQR<Eigen::Matrix<double, 6, DOF> > dec(6, dof);
+
+  Vector6d pose_changed;
+  Eigen::Matrix<double, DOF, 1> angle_changed(dof);
+
+  //best so far (returned when the time is over)
+  Eigen::Matrix<double, DOF, 1> best_joint_value(dof);
+  double best_error = -1.0;
+
+  for (uint16_t count = 0; count < iteration; count++)
+  {
+    workspace->forwardWithJacobian<DOF>(&jacobian);
+
+    pose_changed = poseDifference(target_pose, workspace->getToolPosition(), workspace->getToolOrientation());
+    result->error = pose_changed.norm();
+    result->iteration = count;
+    if (result->error < ik_options_.jacobian_tolerance)
+    {
+      result->success = true;
+      result->exit_reason = IK_CONVERGED;
+      return true;
+    }
+
+    if (best_error < 0.0 || result->error < best_error)
+    {
+      best_error = result->error;
+      for (int8_t index = 0; index < dof; index++)
+        best_joint_value(index) = workspace->getJointValue(index);
+    }
+
+    if (isTimeOut(workspace))
+    {
+      for (int8_t index = 0; index < dof; index++)
+        workspace->setJointValue(index, best_joint_value(index));
+
+      result->error = best_error;
+      result->approximate = true;
+      result->success = (best_error < ik_options_.approximate_tolerance);
+      result->exit_reason = IK_TIME_OUT;
+      return result->success;
+    }
+
+    dec.compute(jacobian);
+    angle_changed = lambda * dec.solve(pose_changed);
+
+    for (int8_t index = 0; index < dof; index++)
+      workspace->setJointValue(index, workspace->getJointValue(index) + angle_changed(index));
+    if (isClampJointLimit())
+      workspace->clampJointValue();
+  }
+  result->success = false;
+  result->iteration = iteration;
+  result->exit_reason = IK_MAX_ITERATION;
   return false;
 }
 
-bool Chain::chainCustomInverseKinematics(Manipulator *manipulator, Name tool_name, Pose target_pose, std::vector<double> *goal_joint_value)
+bool Chain::solvePositionOnlySRInverse(IKWorkspace *workspace, Pose target_pose, IKResult *result)
 {
-  //manipulator
-  Manipulator _manipulator = *manipulator;
+  //sr sovler parameter (orientation error is not weighted)
+  double wn_pos = 1 / 0.3;
 
-  //solver parameter
-  double lambda = 0.0;
-  const double param = 0.002;
-  const int8_t iteration = 10;
+  Vector6d weight;
+  weight << wn_pos, wn_pos, wn_pos, 0.0, 0.0, 0.0;
 
-  const double gamma = 0.5;             //rollback delta
+  if (workspace->getDOF() == CHAIN_FIXED_DOF)
+    return srInverseSolver<CHAIN_FIXED_DOF>(workspace, target_pose, weight, result);
+  else
+    return srInverseSolver<Eigen::Dynamic>(workspace, target_pose, weight, result);
+}
 
+bool Chain::solveSRInverse(IKWorkspace *workspace, Pose target_pose, IKResult *result)
+{
   //sr sovler parameter
   double wn_pos = 1 / 0.3;
   double wn_ang = 1 / (2 * M_PI);
-  double pre_Ek = 0.0;
-  double new_Ek = 0.0;
 
-  Eigen::MatrixXd We(6, 6);
-  We << wn_pos, 0, 0, 0, 0, 0,
-      0, wn_pos, 0, 0, 0, 0,
-      0, 0, wn_pos, 0, 0, 0,
-      0, 0, 0, wn_ang, 0, 0,
-      0, 0, 0, 0, wn_ang, 0,
-      0, 0, 0, 0, 0, wn_ang;
+  Vector6d weight;
+  weight << wn_pos, wn_pos, wn_pos, wn_ang, wn_ang, wn_ang;
 
-  Eigen::MatrixXd Wn = Eigen::MatrixXd::Identity(_manipulator.getDOF(), _manipulator.getDOF());
+  if (workspace->getDOF() == CHAIN_FIXED_DOF)
+    return srInverseSolver<CHAIN_FIXED_DOF>(workspace, target_pose, weight, result);
+  else
+    return srInverseSolver<Eigen::Dynamic>(workspace, target_pose, weight, result);
+}
 
-  //jacobian
-  Eigen::MatrixXd jacobian = Eigen::MatrixXd::Identity(6, _manipulator.getDOF());
-  Eigen::MatrixXd sr_jacobian = Eigen::MatrixXd::Identity(_manipulator.getDOF(), _manipulator.getDOF());
+bool Chain::solveChainCustomInverse(IKWorkspace *workspace, Pose target_pose, IKResult *result)
+{
+  //workspace (seeded by the caller)
 
-  //delta parameter
-  Eigen::VectorXd pose_changed = Eigen::VectorXd::Zero(6);
-  Eigen::VectorXd angle_changed = Eigen::VectorXd::Zero(_manipulator.getDOF());    //delta angle (dq)
-  Eigen::VectorXd gerr(_manipulator.getDOF());
+  //sr sovler parameter
+  double wn_pos = 1 / 0.3;
+  double wn_ang = 1 / (2 * M_PI);
 
-  //angle parameter
-  std::vector<double> present_angle;                                               //angle (q)
-  std::vector<double> set_angle;                                                   //set angle (q + dq)
+  Vector6d weight;
+  weight << wn_pos, wn_pos, wn_pos, wn_ang, wn_ang, wn_ang;
 
-  ////////////////////////////solving//////////////////////////////////
+  workspace->forward();
+
+  //////////////make target ori//////////  //only OpenManipulator Chain
+  Eigen::Matrix3d present_orientation = workspace->getToolOrientation();
+  Eigen::Vector3d present_orientation_rpy = RM_MATH::convertRotationToRPY(present_orientation);
+  Eigen::Matrix3d target_orientation = target_pose.orientation;
+  Eigen::Vector3d target_orientation_rpy = RM_MATH::convertRotationToRPY(target_orientation);
+
+  Eigen::Vector3d joint1_rlative_position = workspace->getRelativePosition(0);
+  Eigen::Vector3d target_position_from_joint1 = target_pose.position - joint1_rlative_position;
+
+  target_orientation_rpy(0) = present_orientation_rpy(0);
+  target_orientation_rpy(1) = target_orientation_rpy(1);
+  target_orientation_rpy(2) = atan2(target_position_from_joint1(1) ,target_position_from_joint1(0));
+
+  target_pose.orientation = RM_MATH::convertRPYToRotation(target_orientation_rpy(0), target_orientation_rpy(1), target_orientation_rpy(2));
+  ///////////////////////////////////////
+
+  if (workspace->getDOF() == CHAIN_FIXED_DOF)
+    return srInverseSolver<CHAIN_FIXED_DOF>(workspace, target_pose, weight, result);
+  else
+    return srInverseSolver<Eigen::Dynamic>(workspace, target_pose, weight, result);
+}
+
+template <int DOF>
+void Chain::jacobian(Manipulator *manipulator, Name tool_name, Eigen::Matrix<double, 6, DOF> *jacobian)
+{
+  Eigen::Vector3d joint_axis = ZERO_VECTOR;
+  Eigen::Vector3d tool_position = manipulator->getComponentPositionFromWorld(tool_name);
+
+  Name my_name =  manipulator->getWorldChildName();
+
+  for (int8_t index = 0; index < manipulator->getDOF(); index++)
+  {
+    Name parent_name = manipulator->getComponentParentName(my_name);
+    if (parent_name == manipulator->getWorldName())
+      joint_axis = manipulator->getWorldOrientation() * manipulator->getAxis(my_name);
+    else
+      joint_axis = manipulator->getComponentOrientationFromWorld(parent_name) * manipulator->getAxis(my_name);
+
+    jacobian->template block<3, 1>(0, index) = joint_axis.cross(tool_position - manipulator->getComponentPositionFromWorld(my_name));
+    jacobian->template block<3, 1>(3, index) = joint_axis;
+
+    my_name = manipulator->getComponentChildName(my_name).at(0); // Get Child name which has active joint
+  }
+}
+template void Chain::jacobian<CHAIN_FIXED_DOF>(Manipulator *manipulator, Name tool_name, Eigen::Matrix<double, 6, CHAIN_FIXED_DOF> *jacobian);
+template void Chain::jacobian<Eigen::Dynamic>(Manipulator *manipulator, Name tool_name, Eigen::Matrix<double, 6, Eigen::Dynamic> *jacobian);
+
+template <int DOF>
+bool Chain::forwardKinematicsWithJacobian(Manipulator *manipulator, Name tool_name, Pose *tool_pose, Eigen::Matrix<double, 6, DOF> *jacobian)
+{
+  IKContext *context = getContext();
+  IKWorkspace *workspace = &context->workspace;
+  if (loadWorkspace(context, manipulator, tool_name) == false)
+    return false;
+
+  jacobian->resize(6, workspace->getDOF());
+  workspace->forwardWithJacobian<DOF>(jacobian);
+
+  tool_pose->position = workspace->getToolPosition();
+  tool_pose->orientation = workspace->getToolOrientation();
+  return true;
+}
+template bool Chain::forwardKinematicsWithJacobian<CHAIN_FIXED_DOF>(Manipulator *manipulator, Name tool_name, Pose *tool_pose, Eigen::Matrix<double, 6, CHAIN_FIXED_DOF> *jacobian);
+template bool Chain::forwardKinematicsWithJacobian<Eigen::Dynamic>(Manipulator *manipulator, Name tool_name, Pose *tool_pose, Eigen::Matrix<double, 6, Eigen::Dynamic> *jacobian);
+
+Vector6d Chain::poseDifference(Pose target_pose, Eigen::Vector3d present_position, Eigen::Matrix3d present_orientation)
+{
+  Vector6d pose_difference;
+  Eigen::AngleAxisd orientation_difference(present_orientation.transpose() * target_pose.orientation);
+
+  pose_difference.head<3>() = target_pose.position - present_position;
+  pose_difference.tail<3>() = present_orientation * (orientation_difference.angle() * orientation_difference.axis());
+
+  return pose_difference;
+}
+
+bool Chain::manipulability(Manipulator *manipulator, Name tool_name, double *manipulability, double *min_singular_value, const std::vector<double> *joint_value)
+{
+  IKContext *context = getContext();
+  IKWorkspace *workspace = &context->workspace;
+  if (loadWorkspace(context, manipulator, tool_name) == false)
+    return false;
+
+  if (joint_value != NULL)
+    workspace->setAllJointValue(*joint_value);
+
+  if (workspace->getDOF() == CHAIN_FIXED_DOF)
+    manipulabilitySolver<CHAIN_FIXED_DOF>(workspace, manipulability, min_singular_value);
+  else
+    manipulabilitySolver<Eigen::Dynamic>(workspace, manipulability, min_singular_value);
+  return true;
+}
+
+template <int DOF>
+void Chain::manipulabilitySolver(IKWorkspace *workspace, double *manipulability, double *min_singular_value)
+{
+  typedef Eigen::Matrix<double, DOF, DOF> SquareMatrix;
+
+  const int8_t dof = workspace->getDOF();
+  Eigen::Matrix<double, 6, DOF> jacobian(6, dof);
+  SquareMatrix jacobian_square(dof, dof);
+
+  workspace->forwardWithJacobian<DOF>(&jacobian);
+  jacobian_square.noalias() = jacobian.transpose() * jacobian;
+
+  // eigenvalues of J^T*J are the squared singular values of J (fixed size : no heap)
+  Eigen::SelfAdjointEigenSolver<SquareMatrix> eigen_solver(jacobian_square, Eigen::EigenvaluesOnly);
+  double product = 1.0;
+  for (int8_t index = 0; index < dof; index++)
+    product *= std::max(eigen_solver.eigenvalues()(index), 0.0);
+
+  *manipulability = sqrt(product);
+  *min_singular_value = sqrt(std::max(eigen_solver.eigenvalues()(0), 0.0)); // ascending order
+}
+
+template void Chain::manipulabilitySolver<CHAIN_FIXED_DOF>(IKWorkspace *workspace, double *manipulability, double *min_singular_value);
+template void Chain::manipulabilitySolver<Eigen::Dynamic>(IKWorkspace *workspace, double *manipulability, double *min_singular_value);
+
+template <int DOF>
+bool Chain::srInverseSolver(IKWorkspace *workspace, Pose target_pose, Vector6d weight, IKResult *result)
+{
+  typedef Eigen::Matrix<double, DOF, DOF> SquareMatrix;
+  typedef Eigen::Matrix<double, DOF, 1> JointVector;
+
+  //workspace (seeded by the caller)
+  const int8_t dof = workspace->getDOF();
+
+  //solver parameter
+  double lambda = 0.0;
+  const double param = ik_options_.damping;
+  const double param_gain = ik_options_.damping_gain;
+  const uint16_t iteration = ik_options_.iteration;
 
-  forwardKinematics(&_manipulator);
+  const double gamma = ik_options_.rollback_gamma;  //rollback delta
 
-  //////////////make target ori//////////  //only OpenManipulator Chain
-  Eigen::Matrix3d present_orientation = _manipulator.getComponentOrientationFromWorld(tool_name);
-  Eigen::Vector3d present_orientation_rpy = RM_MATH::convertRotationToRPY(present_orientation);
-  Eigen::Matrix3d target_orientation = target_pose.orientation;
-  Eigen::Vector3d target_orientation_rpy = RM_MATH::convertRotationToRPY(target_orientation);
+  //sr sovler parameter
+  double pre_Ek = 0.0;
+  double new_Ek = 0.0;
 
-  Eigen::Vector3d joint1_rlative_position = _manipulator.getComponentRelativePositionFromParent(_manipulator.getWorldChildName());
-  Eigen::Vector3d target_position_from_joint1 = target_pose.position - joint1_rlative_position;
+  //jacobian
+  Eigen::Matrix<double, 6, DOF> jacobian(6, dof);
+  SquareMatrix sr_jacobian(dof, dof);
+  Eigen::LDLT<SquareMatrix> dec(dof);
 
-  target_orientation_rpy(0) = present_orientation_rpy(0);
-  target_orientation_rpy(1) = target_orientation_rpy(1);
-  target_orientation_rpy(2) = atan2(target_position_from_joint1(1) ,target_position_from_joint1(0));
+  //delta parameter
+  Vector6d pose_changed;
+  JointVector angle_changed(dof);                                                  //delta angle (dq)
+  JointVector gerr(dof);
 
-  target_pose.orientation = RM_MATH::convertRPYToRotation(target_orientation_rpy(0), target_orientation_rpy(1), target_orientation_rpy(2));
-  ///////////////////////////////////////
+  ////////////////////////////solving//////////////////////////////////
 
+  workspace->forwardWithJacobian<DOF>(&jacobian);
   //////////////checking dx///////////////
-  pose_changed = RM_MATH::poseDifference(target_pose.position, _manipulator.getComponentPositionFromWorld(tool_name), target_pose.orientation, _manipulator.getComponentOrientationFromWorld(tool_name));
-  pre_Ek = pose_changed.transpose() * We * pose_changed;
+  pose_changed = poseDifference(target_pose, workspace->getToolPosition(), workspace->getToolOrientation());
+  pre_Ek = pose_changed.dot(weight.asDiagonal() * pose_changed);
   ///////////////////////////////////////
 
   /////////////////////////////debug/////////////////////////////////
   #if defined(KINEMATICS_DEBUG)
+  Eigen::Vector3d target_orientation_rpy = RM_MATH::convertRotationToRPY(target_pose.orientation);
   Eigen::VectorXd debug_target_pose(6);
   for(int t=0; t<3; t++)
     debug_target_pose(t) = target_pose.position(t);
   for(int t=0; t<3; t++)
     debug_target_pose(t+3) = target_orientation_rpy(t);
 
-  Eigen::Vector3d present_position = _manipulator.getComponentPositionFromWorld(tool_name);
+  Eigen::Vector3d present_position = workspace->getToolPosition();
+  Eigen::MatrixXd present_orientation = workspace->getToolOrientation();
+  Eigen::Vector3d present_orientation_rpy = RM_MATH::convertRotationToRPY(present_orientation);
   Eigen::VectorXd debug_present_pose(6);
   for(int t=0; t<3; t++)
     debug_present_pose(t) = present_position(t);
@@ -569,36 +1730,50 @@ bool Chain::chainCustomInverseKinematics(Manipulator *manipulator, Name tool_nam
   #endif
   ////////////////////////////debug//////////////////////////////////
 
+  //best so far (returned when the time is over, Ek is pre_Ek)
+  JointVector best_joint_value(dof);
+  for (int8_t index = 0; index < dof; index++)
+    best_joint_value(index) = workspace->getJointValue(index);
+
+  //already on the target
+  result->iteration = 0;
+  if (pre_Ek < ik_options_.tolerance)
+  {
+    result->success = true;
+    result->error = pre_Ek;
+    result->exit_reason = IK_CONVERGED;
+    return true;
+  }
+
   //////////////////////////solving loop///////////////////////////////
-  for (int8_t count = 0; count < iteration; count++)
+  for (uint16_t count = 0; count < iteration; count++)
   {
     //////////solve using jacobian//////////
-    jacobian = this->jacobian(&_manipulator, tool_name);
-    lambda = pre_Ek + param;
+    lambda = param_gain * pre_Ek + param;
 
-    sr_jacobian = (jacobian.transpose() * We * jacobian) + (lambda * Wn);     //calculate sr_jacobian (J^T*we*J + lamda*Wn)
-    gerr = jacobian.transpose() * We * pose_changed;                          //calculate gerr (J^T*we) dx
+    sr_jacobian.noalias() = jacobian.transpose() * weight.asDiagonal() * jacobian;   //calculate sr_jacobian (J^T*we*J + lamda*Wn)
+    sr_jacobian.diagonal().array() += lambda;
+    gerr.noalias() = jacobian.transpose() * weight.asDiagonal() * pose_changed;       //calculate gerr (J^T*we) dx
 
-    ColPivHouseholderQR<Eigen::MatrixXd> dec(sr_jacobian);                    //solving (get dq)
+    dec.compute(sr_jacobian);                                                 //solving (get dq)
     angle_changed = dec.solve(gerr);                                          //(J^T*we) * dx = (J^T*we*J + lamda*Wn) * dq
 
-    present_angle = _manipulator.getAllActiveJointValue();
-    set_angle.clear();
-    for (int8_t index = 0; index < _manipulator.getDOF(); index++)
-      set_angle.push_back(present_angle.at(index) + angle_changed(index));
-    _manipulator.setAllActiveJointValue(set_angle);
-    forwardKinematics(&_manipulator);
+    for (int8_t index = 0; index < dof; index++)
+      workspace->setJointValue(index, workspace->getJointValue(index) + angle_changed(index));
+    if (isClampJointLimit())
+      workspace->clampJointValue();
+    workspace->forwardWithJacobian<DOF>(&jacobian);
     ////////////////////////////////////////
 
     //////////////checking dx///////////////
-    pose_changed = RM_MATH::poseDifference(target_pose.position, _manipulator.getComponentPositionFromWorld(tool_name), target_pose.orientation, _manipulator.getComponentOrientationFromWorld(tool_name));
-    new_Ek = pose_changed.transpose() * We * pose_changed;
+    pose_changed = poseDifference(target_pose, workspace->getToolPosition(), workspace->getToolOrientation());
+    new_Ek = pose_changed.dot(weight.asDiagonal() * pose_changed);
     ////////////////////////////////////////
 
     /////////////////////////////debug/////////////////////////////////
     #if defined(KINEMATICS_DEBUG)
-    present_position = _manipulator.getComponentPositionFromWorld(tool_name);
-    present_orientation = _manipulator.getComponentOrientationFromWorld(tool_name);
+    present_position = workspace->getToolPosition();
+    present_orientation = workspace->getToolOrientation();
     present_orientation_rpy = RM_MATH::convertRotationToRPY(present_orientation);
     for(int t=0; t<3; t++)
       debug_present_pose(t) = present_position(t);
@@ -615,7 +1790,8 @@ bool Chain::chainCustomInverseKinematics(Manipulator *manipulator, Name tool_nam
     #endif
     ////////////////////////////debug//////////////////////////////////
 
-    if (new_Ek < 1E-12)
+    result->iteration = count + 1;
+    if (new_Ek < ik_options_.tolerance)
     {
       /////////////////////////////debug/////////////////////////////////
       #if defined(KINEMATICS_DEBUG)
@@ -625,37 +1801,814 @@ bool Chain::chainCustomInverseKinematics(Manipulator *manipulator, Name tool_nam
       RM_LOG::PRINTLN("------------------------------------");
       #endif
       //////////////////////////debug//////////////////////////////////
-      *goal_joint_value = _manipulator.getAllActiveJointValue();
+      result->success = true;
+      result->error = new_Ek;
+      result->exit_reason = IK_CONVERGED;
       return true;
     }
     else if (new_Ek < pre_Ek)
     {
       pre_Ek = new_Ek;
+      for (int8_t index = 0; index < dof; index++)
+        best_joint_value(index) = workspace->getJointValue(index);
+    }
+    else
+    {
+      for (int8_t index = 0; index < dof; index++)
+        workspace->setJointValue(index, workspace->getJointValue(index) - (gamma * angle_changed(index)));
+      if (isClampJointLimit())
+        workspace->clampJointValue();
+
+      workspace->forwardWithJacobian<DOF>(&jacobian);
+      pose_changed = poseDifference(target_pose, workspace->getToolPosition(), workspace->getToolOrientation());
+    }
+
+    if (isTimeOut(workspace))
+    {
+      for (int8_t index = 0; index < dof; index++)
+        workspace->setJointValue(index, best_joint_value(index));
+
+      result->error = pre_Ek;
+      result->approximate = true;
+      result->success = (pre_Ek < ik_options_.approximate_tolerance);
+      result->exit_reason = IK_TIME_OUT;
+      return result->success;
+    }
+  }
+  result->success = false;
+  result->error = pose_changed.dot(weight.asDiagonal() * pose_changed);
+  result->exit_reason = IK_MAX_ITERATION;
+  return false;
+}
+
+bool Chain::analyticInverseKinematics(Manipulator *manipulator, Name tool_name, Pose target_pose, std::vector<double> *goal_joint_value)
+{
+  return solveInverse(manipulator, tool_name, target_pose, goal_joint_value, &Chain::solveAnalyticInverse, "[analytic]fail to solve inverse kinematics (out of workspace or joint limit)");
+}
+
+bool Chain::solveAnalyticInverseKinematics(Manipulator *manipulator, Name tool_name, Pose target_pose, std::vector<std::vector<double> > *solutions)
+{
+  IKContext *context = getContext();
+
+  solutions->clear();
+  if (loadWorkspace(context, manipulator, tool_name) == false)
+    return false;
+
+  AnalyticSolution solution;
+  if (analyticInverseSolutions(&context->workspace, target_pose, &solution) == false)
+    return false;
+
+  for (uint8_t index = 0; index < solution.size; index++)
+    solutions->push_back(std::vector<double>(solution.joint_value[index], solution.joint_value[index] + CHAIN_FIXED_DOF));
+  return true;
+}
+
+bool Chain::solveAnalyticInverse(IKWorkspace *workspace, Pose target_pose, IKResult *result)
+{
+  AnalyticSolution solution;
+
+  if (analyticInverseSolutions(workspace, target_pose, &solution))
+  {
+    //////////////select the closest branch to the seed//////////////
+    double min_distance = 0.0;
+    int8_t min_index = -1;
+
+    for (uint8_t index = 0; index < solution.size; index++)
+    {
+      double distance = 0.0;
+      for (int8_t joint = 0; joint < CHAIN_FIXED_DOF; joint++)
+        distance += pow(solution.joint_value[index][joint] - workspace->getJointValue(joint), 2);
+
+      if (min_index < 0 || distance < min_distance)
+      {
+        min_distance = distance;
+        min_index = index;
+      }
+    }
+    for (int8_t joint = 0; joint < CHAIN_FIXED_DOF; joint++)
+      workspace->setJointValue(joint, solution.joint_value[min_index][joint]);
+    result->success = true;
+    result->exit_reason = IK_CONVERGED;
+  }
+  else
+  {
+    result->success = false;
+    result->exit_reason = IK_NO_SOLUTION;
+  }
+  result->iteration = 0;
+
+  // the 4 DOF chain cannot roll, so the residual is not always zero
+  workspace->forward();
+  result->error = poseDifference(target_pose, workspace->getToolPosition(), workspace->getToolOrientation()).norm();
+  return result->success;
+}
+
+bool Chain::analyticInverseSolutions(IKWorkspace *workspace, Pose target_pose, AnalyticSolution *solution)
+{
+  // Closed form solution for the OpenManipulator Chain (yaw joint + 3 pitch joints on the same plane)
+  solution->size = 0;
+
+  if (workspace->getDOF() != CHAIN_FIXED_DOF)
+  {
+    RM_LOG::ERROR("[analytic]only 4 DOF chain is supported");
+    return false;
+  }
+
+  //////////////get chain geometry//////////////
+  Name joint_name[4];
+  Eigen::Vector3d offset[5];
+
+  for (int8_t index = 0; index < 4; index++)
+    joint_name[index] = workspace->getJointName(index);
+  for (int8_t index = 0; index < 5; index++)
+    offset[index] = workspace->getRelativePosition(index);
+
+  if ((workspace->getAxis(0) - RM_MATH::makeVector3(0.0, 0.0, 1.0)).norm() > 1E-6 ||
+      (workspace->getAxis(1) - RM_MATH::makeVector3(0.0, 1.0, 0.0)).norm() > 1E-6 ||
+      (workspace->getAxis(2) - RM_MATH::makeVector3(0.0, 1.0, 0.0)).norm() > 1E-6 ||
+      (workspace->getAxis(3) - RM_MATH::makeVector3(0.0, 1.0, 0.0)).norm() > 1E-6 ||
+      fabs(offset[1](1)) > 1E-9 || fabs(offset[2](1)) > 1E-9 || fabs(offset[3](1)) > 1E-9 || fabs(offset[4](1)) > 1E-9)
+  {
+    RM_LOG::ERROR("[analytic]the chain is not a yaw joint with planar pitch joints");
+    return false;
+  }
+
+  //////////////target from joint1//////////////
+  Eigen::Matrix3d world_orientation = workspace->getWorldOrientation();
+  Eigen::Vector3d target_position = world_orientation.transpose() * (target_pose.position - workspace->getWorldPosition()) - offset[0];
+  Eigen::Vector3d target_approach = world_orientation.transpose() * target_pose.orientation.col(0);
+  Eigen::Vector3d target_pitch_axis = world_orientation.transpose() * target_pose.orientation.col(1);
+
+  // link2 and link3 on the arm plane (r : horizontal, z : vertical)
+  double link2_length = sqrt(pow(offset[2](0), 2) + pow(offset[2](2), 2));
+  double link3_length = sqrt(pow(offset[3](0), 2) + pow(offset[3](2), 2));
+  double link2_angle = atan2(offset[2](2), offset[2](0));
+  double link3_angle = atan2(offset[3](2), offset[3](0));
+
+  double joint1_angle[2];
+  uint8_t joint1_branch = 2;
+  if (sqrt(pow(target_position(0), 2) + pow(target_position(1), 2)) < 1E-9)
+  {
+    // target on the joint1 axis : keep the present yaw
+    joint1_angle[0] = workspace->getJointValue(0);
+  }
+  else
+  {
+    joint1_angle[0] = atan2(target_position(1), target_position(0));
+  }
+  joint1_angle[1] = joint1_angle[0] + M_PI;
+
+  for (uint8_t branch = 0; branch < joint1_branch; branch++)
+  {
+    double q1 = atan2(sin(joint1_angle[branch]), cos(joint1_angle[branch]));
+    double c1 = cos(q1);
+    double s1 = sin(q1);
+
+    // the pitch axis of the reversed yaw is flipped (the tool is rolled by pi)
+    if (-s1 * target_pitch_axis(0) + c1 * target_pitch_axis(1) < -1E-6)
+      continue;
+
+    // tool pitch projected on the arm plane (q2 + q3 + q4)
+    double pitch = atan2(-target_approach(2), c1 * target_approach(0) + s1 * target_approach(1));
+
+    // wrist (joint4) position from joint2 on the arm plane
+    double target_r = c1 * target_position(0) + s1 * target_position(1);
+    double target_z = target_position(2);
+    double wrist_r = target_r - (offset[4](0) * cos(pitch) + offset[4](2) * sin(pitch)) - offset[1](0);
+    double wrist_z = target_z - (-offset[4](0) * sin(pitch) + offset[4](2) * cos(pitch)) - offset[1](2);
+
+    double cos_elbow = (pow(wrist_r, 2) + pow(wrist_z, 2) - pow(link2_length, 2) - pow(link3_length, 2)) / (2 * link2_length * link3_length);
+    if (cos_elbow > 1.0 + 1E-9 || cos_elbow < -1.0 - 1E-9)
+      continue;
+    if (cos_elbow > 1.0) cos_elbow = 1.0;
+    if (cos_elbow < -1.0) cos_elbow = -1.0;
+
+    double elbow[2] = {acos(cos_elbow), -acos(cos_elbow)};
+    uint8_t elbow_branch = (fabs(elbow[0]) < 1E-9 || fabs(elbow[0] - M_PI) < 1E-9) ? 1 : 2;
+
+    for (uint8_t index = 0; index < elbow_branch; index++)
+    {
+      double link2_plane_angle = atan2(wrist_z, wrist_r) - atan2(link3_length * sin(elbow[index]), link2_length + link3_length * cos(elbow[index]));
+      double link3_plane_angle = link2_plane_angle + elbow[index];
+
+      // written on the next free row, kept only inside the joint limits
+      double *joint_value = solution->joint_value[solution->size];
+      joint_value[0] = q1;
+      joint_value[1] = link2_angle - link2_plane_angle;
+      joint_value[2] = link3_angle - link3_plane_angle - joint_value[1];
+      joint_value[3] = pitch - joint_value[1] - joint_value[2];
+
+      bool in_limit = true;
+      for (uint8_t joint = 0; joint < CHAIN_FIXED_DOF; joint++)
+      {
+        joint_value[joint] = atan2(sin(joint_value[joint]), cos(joint_value[joint]));
+        if (checkJointLimit(joint_name[joint], joint_value[joint]) == false)
+          in_limit = false;
+      }
+
+      if (in_limit)
+        solution->size++;
+    }
+  }
+
+  return (solution->size > 0);
+}
+
+bool Chain::resolvedRate(Manipulator *manipulator, Name tool_name, Vector6d twist, double time_step, std::vector<double> *goal_joint_value)
+{
+  IKContext *context = getContext();
+  IKWorkspace *workspace = &context->workspace;
+  if (loadWorkspace(context, manipulator, tool_name) == false)
+    return false;
+
+  // integrate from the goal of the previous tick (the present joint values on the first tick)
+  if (goal_joint_value->size() == (uint8_t)workspace->getDOF())
+    workspace->setAllJointValue(*goal_joint_value);
+
+  if (workspace->getDOF() == CHAIN_FIXED_DOF)
+    resolvedRateSolver<CHAIN_FIXED_DOF>(workspace, twist, time_step);
+  else
+    resolvedRateSolver<Eigen::Dynamic>(workspace, twist, time_step);
+
+  workspace->getAllJointValue(goal_joint_value);
+  return true;
+}
+
+template <int DOF>
+void Chain::resolvedRateSolver(IKWorkspace *workspace, Vector6d twist, double time_step)
+{
+  typedef Eigen::Matrix<double, DOF, DOF> SquareMatrix;
+  typedef Eigen::Matrix<double, DOF, 1> JointVector;
+
+  const int8_t dof = workspace->getDOF();
+  const double max_velocity = ik_options_.rate_max_joint_velocity;
+  const double limit_margin = 0.1;      // rad, slow down from here to the joint limit
+
+  Vector6d weight;
+  weight << 1.0, 1.0, 1.0, ik_options_.rate_orientation_weight, ik_options_.rate_orientation_weight, ik_options_.rate_orientation_weight;
+
+  Eigen::Matrix<double, 6, DOF> jacobian(6, dof);
+  SquareMatrix rate_jacobian(dof, dof);
+  Eigen::LDLT<SquareMatrix> dec(dof);
+  JointVector joint_velocity(dof);
+  JointVector gerr(dof);
+
+  workspace->forwardWithJacobian<DOF>(&jacobian);
+
+  //////////////dq = (J^T*W*J + lambda*I)^-1 * J^T*W * v, a joint driven into its limit is locked and solved again//////////////
+  double scale = 1.0;
+  for (int8_t lock_count = 0; lock_count <= dof; lock_count++)
+  {
+    rate_jacobian.noalias() = jacobian.transpose() * weight.asDiagonal() * jacobian;
+    rate_jacobian.diagonal().array() += ik_options_.rate_damping;
+    gerr.noalias() = jacobian.transpose() * weight.asDiagonal() * twist;
+
+    dec.compute(rate_jacobian);
+    joint_velocity = dec.solve(gerr);
+
+    bool locked = false;
+    scale = 1.0;
+    for (int8_t index = 0; index < dof; index++)
+    {
+      double speed = fabs(joint_velocity(index));
+      if (speed < 1E-12)
+        continue;
+
+      double distance = (joint_velocity(index) > 0.0) ? workspace->getJointMax(index) - workspace->getJointValue(index)
+                                                      : workspace->getJointValue(index) - workspace->getJointMin(index);
+      double allowed_velocity = max_velocity * std::min(1.0, std::max(distance, 0.0) / limit_margin);
+
+      if (allowed_velocity < 1E-3 * max_velocity)
+      {
+        jacobian.col(index).setZero();
+        locked = true;
+      }
+      else if (speed * scale > allowed_velocity)
+        scale = allowed_velocity / speed;
+    }
+
+    if (locked == false)
+      break;
+  }
+
+  //////////////integrate (same direction, slowed down for the speed and the limits)//////////////
+  for (int8_t index = 0; index < dof; index++)
+    workspace->setJointValue(index, workspace->getJointValue(index) + scale * joint_velocity(index) * time_step);
+  workspace->clampJointValue();
+}
+
+template void Chain::resolvedRateSolver<CHAIN_FIXED_DOF>(IKWorkspace *workspace, Vector6d twist, double time_step);
+template void Chain::resolvedRateSolver<Eigen::Dynamic>(IKWorkspace *workspace, Vector6d twist, double time_step);
+
+bool Chain::generateReachabilityMap(Manipulator *manipulator, Name tool_name, double resolution, STRING file_name)
+{
+  ChainFKKernel kernel;
+  IKWorkspace workspace;
+  if (kernel.build(manipulator, tool_name) == false || workspace.build(manipulator, tool_name) == false)
+    return false;
+
+  const int8_t dof = workspace.getDOF();
+
+  //////////////joint grid (one step moves the tool about one cell)//////////////
+  std::vector<double> joint_min(dof), joint_step(dof);
+  std::vector<uint32_t> step_size(dof);
+  uint64_t sample_size = 1;
+  double reach = 0.0;
+
+  for (int8_t index = dof - 1; index >= 0; index--)
+  {
+    reach += workspace.getRelativePosition(index + 1).norm();
+
+    double max_limit = M_PI, min_limit = -M_PI;
+    std::map<Name, JointLimit>::iterator it = joint_limit_.find(workspace.getJointName(index));
+    if (it != joint_limit_.end())
+    {
+      max_limit = it->second.max;
+      min_limit = it->second.min;
+    }
+
+    step_size.at(index) = (uint32_t)ceil((max_limit - min_limit) * reach / resolution) + 1;
+    joint_min.at(index) = min_limit;
+    joint_step.at(index) = (max_limit - min_limit) / (step_size.at(index) - 1);
+    sample_size *= step_size.at(index);
+  }
+
+  if (sample_size > 1000000000)
+  {
+    RM_LOG::ERROR("[reachability map]resolution is too small");
+    return false;
+  }
+
+  //////////////grid (sphere of the reach around joint1)//////////////
+  ReachabilityMapHeader header;
+  memcpy(header.magic, "OMRM", 4);
+  header.version = REACHABILITY_MAP_VERSION;
+  header.dof = dof;
+  header.resolution = resolution;
+
+  Eigen::Vector3d joint1_position = workspace.getWorldOrientation() * workspace.getRelativePosition(0) + workspace.getWorldPosition();
+  for (int8_t axis = 0; axis < 3; axis++)
+  {
+    header.size[axis] = (uint32_t)ceil(2.0 * (reach + resolution) / resolution);
+    header.min[axis] = joint1_position(axis) - (reach + resolution);
+  }
+
+  const uint32_t stride = dof + 1;
+  const size_t cell_size = (size_t)header.size[0] * header.size[1] * header.size[2];
+  std::vector<float> cell(cell_size * stride, 0.0f);
+  std::vector<double> center_distance(cell_size, -1.0);
+
+  //////////////sampling (keep the sample closest to the cell center)//////////////
+  const uint32_t chunk_size = 4096;
+  std::vector<std::vector<double> > joint_value(dof, std::vector<double>(chunk_size));
+  std::vector<const double *> joint_value_pointer(dof);
+  for (int8_t index = 0; index < dof; index++)
+    joint_value_pointer.at(index) = &joint_value.at(index)[0];
+  std::vector<double> x(chunk_size), y(chunk_size), z(chunk_size);
+  std::vector<uint32_t> counter(dof, 0);
+
+  for (uint64_t sample = 0; sample < sample_size; sample += chunk_size)
+  {
+    uint32_t size = (sample_size - sample < chunk_size) ? (uint32_t)(sample_size - sample) : chunk_size;
+
+    for (uint32_t num = 0; num < size; num++)
+    {
+      for (int8_t index = 0; index < dof; index++)
+        joint_value.at(index)[num] = joint_min.at(index) + joint_step.at(index) * counter.at(index);
+
+      for (int8_t index = dof - 1; index >= 0; index--)
+      {
+        if (++counter.at(index) < step_size.at(index))
+          break;
+        counter.at(index) = 0;
+      }
+    }
+
+    kernel.solve(&joint_value_pointer[0], size, &x[0], &y[0], &z[0]);
+
+    for (uint32_t num = 0; num < size; num++)
+    {
+      double position[3] = {x[num], y[num], z[num]};
+      double distance = 0.0;
+      size_t cell_index = 0;
+
+      for (int8_t axis = 2; axis >= 0; axis--)
+      {
+        double grid = (position[axis] - header.min[axis]) / resolution;
+        uint32_t index = (uint32_t)grid;
+        distance += pow(grid - index - 0.5, 2);
+        cell_index = cell_index * header.size[axis] + index;
+      }
+
+      if (center_distance.at(cell_index) < 0.0 || distance < center_distance.at(cell_index))
+      {
+        center_distance.at(cell_index) = distance;
+        cell.at(cell_index * stride) = 1.0f;
+        for (int8_t index = 0; index < dof; index++)
+          cell.at(cell_index * stride + 1 + index) = joint_value.at(index)[num];
+      }
+    }
+  }
+
+  //////////////grow one cell so that the border is not rejected by sampling gaps//////////////
+  // (a neighbor on the same row, column or layer only : the flat index wraps at the grid border)
+  const int32_t neighbor[3] = {1, (int32_t)header.size[0], (int32_t)(header.size[0] * header.size[1])};
+  for (size_t cell_index = 0; cell_index < cell_size; cell_index++)
+  {
+    if (center_distance.at(cell_index) >= 0.0)
+      continue;
+
+    const uint32_t coordinate[3] = {(uint32_t)(cell_index % header.size[0]),
+                                    (uint32_t)((cell_index / header.size[0]) % header.size[1]),
+                                    (uint32_t)(cell_index / ((size_t)header.size[0] * header.size[1]))};
+
+    for (int8_t axis = 0; axis < 3 && cell.at(cell_index * stride) < 0.5f; axis++)
+    {
+      for (int8_t sign = -1; sign <= 1; sign += 2)
+      {
+        if ((sign < 0 && coordinate[axis] == 0) || (sign > 0 && coordinate[axis] + 1 == header.size[axis]))
+          continue;
+
+        int64_t neighbor_index = (int64_t)cell_index + sign * neighbor[axis];
+        if (center_distance.at(neighbor_index) < 0.0)
+          continue;
+
+        for (uint32_t index = 0; index < stride; index++)
+          cell.at(cell_index * stride + index) = cell.at(neighbor_index * stride + index);
+        break;
+      }
     }
+  }
+
+  return ReachabilityMap::save(file_name, header, cell);
+}
+
+bool Chain::loadReachabilityMap(STRING file_name)
+{
+  return reachability_map_.load(file_name);
+}
+
+bool Chain::buildWorkspaceEnvelope(Manipulator *manipulator, Name tool_name)
+{
+  envelope_tool_name_ = tool_name;
+  envelope_state_.store(ENVELOPE_BUILDING, std::memory_order_relaxed);
+
+  IKWorkspace workspace;
+  workspace_envelope_.clear();
+  if (workspace.build(manipulator, tool_name, &joint_limit_) == false || workspace_envelope_.build(&workspace) == false)
+  {
+    envelope_state_.store(ENVELOPE_NONE, std::memory_order_release); // no envelope on this chain
+    return false;
+  }
+
+  envelope_state_.store(ENVELOPE_READY, std::memory_order_release);
+  return true;
+}
+
+bool Chain::updateWorkspaceEnvelope(Manipulator *manipulator, STRING *reason)
+{
+  uint8_t state = envelope_state_.load(std::memory_order_acquire);
+  if (state == ENVELOPE_READY)
+    return true;
+
+  // one thread rebuilds it, the others reject their goals meanwhile
+  if (state != ENVELOPE_STALE || envelope_state_.compare_exchange_strong(state, ENVELOPE_BUILDING, std::memory_order_acquire) == false)
+  {
+    if (reason != NULL)
+      *reason = "workspace envelope being rebuilt";
+    return false;
+  }
+
+  IKWorkspace workspace;
+  if (workspace.build(manipulator, envelope_tool_name_, &joint_limit_) && workspace_envelope_.build(&workspace))
+  {
+    envelope_state_.store(ENVELOPE_READY, std::memory_order_release);
+    return true;
+  }
+
+  envelope_state_.store(ENVELOPE_STALE, std::memory_order_release); // it was there, goals stay rejected
+  RM_LOG::ERROR("[checkTaskSpaceGoal] failed to rebuild the workspace envelope of " + envelope_tool_name_);
+  if (reason != NULL)
+    *reason = "no workspace envelope";
+  return false;
+}
+
+bool Chain::checkTaskSpaceGoal(Manipulator *manipulator, Name tool_name, Pose target_pose, STRING *reason, TaskGoalKeep keep)
+{
+  if (envelope_state_.load(std::memory_order_acquire) == ENVELOPE_NONE || tool_name != envelope_tool_name_)
+    return true;
+  if (updateWorkspaceEnvelope(manipulator, reason) == false)
+    return false;
+
+  IKContext *context = getContext();
+  IKWorkspace *workspace = &context->workspace;
+  if (loadWorkspace(context, manipulator, tool_name) == false)
+    return true;
+
+  if (keep != TASK_GOAL_KEEP_NONE)
+  {
+    workspace->forward();
+    if (keep == TASK_GOAL_KEEP_POSITION)
+      target_pose.position = workspace->getToolPosition();
     else
+      target_pose.orientation = workspace->getToolOrientation();
+  }
+
+  STRING fail_reason = "";
+
+  //////////////target from joint1//////////////
+  Eigen::Vector3d target_position = workspace->getWorldOrientation().transpose() * (target_pose.position - workspace->getWorldPosition()) -
+                                    workspace->getRelativePosition(0);
+  double target_radius = sqrt(pow(target_position(0), 2) + pow(target_position(1), 2));
+
+  if (target_radius < ik_options_.workspace_min_radius)
+    fail_reason = "too close to the joint1 axis";
+  else
+  {
+    //////////////both yaw branches : reach, then the joint limit envelope on the arm plane//////////////
+    const Eigen::Vector3d joint2_offset = workspace->getRelativePosition(1);
+    const double yaw = atan2(target_position(1), target_position(0));
+    bool in_yaw_limit = false, in_reach = false, in_envelope = false;
+
+    for (uint8_t branch = 0; branch < 2 && in_envelope == false; branch++)
     {
-      present_angle = _manipulator.getAllActiveJointValue();
-      for (int8_t index = 0; index < _manipulator.getDOF(); index++)
-        set_angle.push_back(present_angle.at(index) - (gamma * angle_changed(index)));
-      _manipulator.setAllActiveJointValue(set_angle);
+      double joint1_value = (branch == 0) ? yaw : atan2(-sin(yaw), -cos(yaw));
+      if (checkJointLimit(workspace->getJointName(0), joint1_value) == false)
+        continue;
+      in_yaw_limit = true;
+
+      double plane_r = ((branch == 0) ? target_radius : -target_radius) - joint2_offset(0);
+      double plane_z = target_position(2) - joint2_offset(2);
+      if (sqrt(plane_r * plane_r + plane_z * plane_z) > workspace_envelope_.getMaxReach())
+        continue;
+      in_reach = true;
+
+      in_envelope = workspace_envelope_.isReachable(plane_r, plane_z);
+    }
+
+    if (in_yaw_limit == false)
+      fail_reason = "out of the joint1 limit";
+    else if (in_reach == false)
+      fail_reason = "beyond the reach";
+    else if (in_envelope == false)
+      fail_reason = "outside the joint limit envelope";
+  }
 
-      forwardKinematics(&_manipulator);
+  //////////////orientation the solver goes to//////////////
+  const uint8_t inverse_solver = inverse_solver_.load(std::memory_order_relaxed);
+  if (fail_reason == "" && inverse_solver != INVERSE_SOLVER_POSITION_ONLY && workspace->getDOF() == 4)
+  {
+    if (inverse_solver == INVERSE_SOLVER_CHAIN_CUSTOM)
+    {
+      // same projection as the chain custom solver : present roll, target pitch, yaw to the target
+      workspace->forward();
+      Eigen::Vector3d present_orientation_rpy = RM_MATH::convertRotationToRPY(workspace->getToolOrientation());
+      Eigen::Vector3d target_orientation_rpy = RM_MATH::convertRotationToRPY(target_pose.orientation);
+      Eigen::Vector3d target_position_from_joint1 = target_pose.position - workspace->getRelativePosition(0);
+
+      target_pose.orientation = RM_MATH::convertRPYToRotation(present_orientation_rpy(0), target_orientation_rpy(1),
+                                                              atan2(target_position_from_joint1(1), target_position_from_joint1(0)));
     }
+
+    AnalyticSolution solution;
+    if (analyticInverseSolutions(workspace, target_pose, &solution) == false)
+      fail_reason = "orientation out of the joint limits at this position";
   }
-  RM_LOG::ERROR("[OpenManipulator Chain Custom]fail to solve inverse kinematics");
-  *goal_joint_value = _manipulator.getAllActiveJointValue();
+
+  if (fail_reason == "")
+    return true;
+
+  if (reason != NULL)
+    *reason = fail_reason;
   return false;
 }
 
+void Chain::setIKOptions(IKOptions options)
+{
+  ik_options_ = options;
+#if !defined(__OPENCR__)
+  if (thread_pool_.getThreadSize() != ik_options_.thread)
+    thread_pool_.start(ik_options_.thread);
+#endif
+}
+
+IKOptions Chain::getIKOptions()
+{
+  return ik_options_;
+}
+
+IKResult Chain::getIKResult()
+{
+  return getContext()->result;
+}
+
+bool Chain::getPresentJointValue(Manipulator *manipulator, Name tool_name, std::vector<double> *joint_value)
+{
+  IKContext *context = getContext();
+  if (loadWorkspace(context, manipulator, tool_name) == false)
+    return false;
+
+  context->workspace.getAllJointValue(joint_value);
+  return true;
+}
+
+void Chain::setJointLimit(Name joint_name, double max_limit, double min_limit)
+{
+  JointLimit limit;
+  limit.max = max_limit;
+  limit.min = min_limit;
+  joint_limit_[joint_name] = limit;
+  description_version_++; // workspaces are rebuilt with the new limit
+
+  uint8_t state = ENVELOPE_READY;
+  envelope_state_.compare_exchange_strong(state, ENVELOPE_STALE);
+}
+
+bool Chain::checkJointLimit(Name joint_name, double value)
+{
+  std::map<Name, JointLimit>::iterator it = joint_limit_.find(joint_name);
+  if (it == joint_limit_.end())
+    return true;
+
+  return (value <= it->second.max && value >= it->second.min);
+}
+
 void Chain::setOption(const void *arg)
 {
   STRING *get_arg_ = (STRING *)arg;
 
   if(get_arg_[0] =="inverse_solver")
   {
-    STRING inverse_solver_option = get_arg_[1];
-    inverse_solver_option_ = inverse_solver_option;
+    uint8_t inverse_solver = INVERSE_SOLVER_UNKNOWN;
+    for (uint8_t index = INVERSE_SOLVER_POSITION_ONLY; index <= INVERSE_SOLVER_ANALYTIC; index++)
+    {
+      if (get_arg_[1] == inverse_solver_name[index])
+        inverse_solver = index;
+    }
+    inverse_solver_.store(inverse_solver, std::memory_order_relaxed);
+  }
+  else if(get_arg_[0] == "ik_iteration")
+    ik_options_.iteration = std::atoi(get_arg_[1].c_str());
+  else if(get_arg_[0] == "ik_tolerance")
+    ik_options_.tolerance = std::atof(get_arg_[1].c_str());
+  else if(get_arg_[0] == "ik_jacobian_tolerance")
+    ik_options_.jacobian_tolerance = std::atof(get_arg_[1].c_str());
+  else if(get_arg_[0] == "ik_jacobian_step")
+    ik_options_.jacobian_step = std::atof(get_arg_[1].c_str());
+  else if(get_arg_[0] == "ik_damping")
+    ik_options_.damping = std::atof(get_arg_[1].c_str());
+  else if(get_arg_[0] == "ik_damping_gain")
+    ik_options_.damping_gain = std::atof(get_arg_[1].c_str());
+  else if(get_arg_[0] == "ik_rollback_gamma")
+    ik_options_.rollback_gamma = std::atof(get_arg_[1].c_str());
+  else if(get_arg_[0] == "ik_time_budget")
+    ik_options_.time_budget = std::atof(get_arg_[1].c_str());
+  else if(get_arg_[0] == "ik_approximate_tolerance")
+    ik_options_.approximate_tolerance = std::atof(get_arg_[1].c_str());
+  else if(get_arg_[0] == "ik_clamp_joint_limit")
+    ik_options_.clamp_joint_limit = (get_arg_[1] == "true");
+  else if(get_arg_[0] == "ik_multi_start")
+    ik_options_.multi_start = (get_arg_[1] == "true");
+  else if(get_arg_[0] == "ik_thread")
+  {
+    IKOptions options = ik_options_;
+    options.thread = std::atoi(get_arg_[1].c_str());
+    setIKOptions(options);
+  }
+  else if(get_arg_[0] == "ik_rate_damping")
+    ik_options_.rate_damping = std::atof(get_arg_[1].c_str());
+  else if(get_arg_[0] == "ik_rate_orientation_weight")
+    ik_options_.rate_orientation_weight = std::atof(get_arg_[1].c_str());
+  else if(get_arg_[0] == "ik_rate_max_joint_velocity")
+    ik_options_.rate_max_joint_velocity = std::atof(get_arg_[1].c_str());
+  else if(get_arg_[0] == "ik_workspace_min_radius")
+    ik_options_.workspace_min_radius = std::atof(get_arg_[1].c_str());
+}
+
+
+
+//-------------------- OpenManipulator Chain (compile-time description) --------------------//
+
+static const char *static_link_name[5] = {"joint1", "joint2", "joint3", "joint4", "gripper"};
+
+OpenManipulatorChainStatic::OpenManipulatorChainStatic()
+  :Chain(),
+   description_state_(DESCRIPTION_UNCHECKED)
+{
+  for (int8_t index = 0; index < 5; index++)
+    link_name_[index] = static_link_name[index];
+}
+
+bool OpenManipulatorChainStatic::checkDescription(Manipulator *manipulator)
+{
+  uint8_t state = description_state_.load(std::memory_order_acquire);
+  if (state != DESCRIPTION_UNCHECKED)
+    return (state == DESCRIPTION_MATCHED);
+
+  // the result is published only when it is complete (concurrent first callers get the same one)
+  bool matched = matchDescription(manipulator);
+  description_state_.store(matched ? DESCRIPTION_MATCHED : DESCRIPTION_DIFFERENT, std::memory_order_release);
+  return matched;
+}
+
+bool OpenManipulatorChainStatic::matchDescription(Manipulator *manipulator)
+{
+  const Eigen::Vector3d offset[5] = {RM_MATH::makeVector3(OpenManipulatorJoint1::x(), OpenManipulatorJoint1::y(), OpenManipulatorJoint1::z()),
+                                     RM_MATH::makeVector3(OpenManipulatorJoint2::x(), OpenManipulatorJoint2::y(), OpenManipulatorJoint2::z()),
+                                     RM_MATH::makeVector3(OpenManipulatorJoint3::x(), OpenManipulatorJoint3::y(), OpenManipulatorJoint3::z()),
+                                     RM_MATH::makeVector3(OpenManipulatorJoint4::x(), OpenManipulatorJoint4::y(), OpenManipulatorJoint4::z()),
+                                     RM_MATH::makeVector3(OpenManipulatorGripper::x(), OpenManipulatorGripper::y(), OpenManipulatorGripper::z())};
+  const AxisType axis[5] = {OpenManipulatorJoint1::axis(), OpenManipulatorJoint2::axis(), OpenManipulatorJoint3::axis(),
+                            OpenManipulatorJoint4::axis(), OpenManipulatorGripper::axis()};
+
+  if (manipulator->getDOF() != 4 || manipulator->getWorldChildName() != static_link_name[0] ||
+      manipulator->getWorldPosition().norm() > 1E-9 || (manipulator->getWorldOrientation() - Eigen::Matrix3d::Identity()).norm() > 1E-9)
+  {
+    RM_LOG::ERROR("[OpenManipulatorChainStatic]the manipulator is not the OpenManipulator Chain, use Chain");
+    return false;
   }
+
+  for (int8_t index = 0; index < 5; index++)
+  {
+    Name name = static_link_name[index];
+    if (index > 0 && manipulator->getComponentParentName(name) != static_link_name[index - 1])
+    {
+      RM_LOG::ERROR("[OpenManipulatorChainStatic]the manipulator is not the OpenManipulator Chain, use Chain");
+      return false;
+    }
+    if ((manipulator->getComponentRelativePositionFromParent(name) - offset[index]).norm() > 1E-9 ||
+        getAxisType(manipulator->getAxis(name)) != axis[index])
+    {
+      RM_LOG::ERROR("[OpenManipulatorChainStatic]the description is different from the compiled one : " + name);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void OpenManipulatorChainStatic::forward(const double joint_value[4], Eigen::Vector3d position[5], Eigen::Matrix3d orientation[5])
+{
+  staticLinkForward<OpenManipulatorJoint1>(Eigen::Vector3d::Zero(), Eigen::Matrix3d::Identity(), joint_value[0], &position[0], &orientation[0]);
+  staticLinkForward<OpenManipulatorJoint2>(position[0], orientation[0], joint_value[1], &position[1], &orientation[1]);
+  staticLinkForward<OpenManipulatorJoint3>(position[1], orientation[1], joint_value[2], &position[2], &orientation[2]);
+  staticLinkForward<OpenManipulatorJoint4>(position[2], orientation[2], joint_value[3], &position[3], &orientation[3]);
+  staticLinkForward<OpenManipulatorGripper>(position[3], orientation[3], 0.0, &position[4], &orientation[4]);
+}
+
+void OpenManipulatorChainStatic::forwardWithJacobian(const double joint_value[4], Eigen::Vector3d position[5], Eigen::Matrix3d orientation[5],
+                                                     Eigen::Matrix<double, 6, 4> *jacobian)
+{
+  forward(joint_value, position, orientation);
+
+  // joint axis from world : the axis column of the parent orientation
+  jacobian->block<3, 1>(3, 0) = Eigen::Vector3d::UnitZ();
+  jacobian->block<3, 1>(3, 1) = orientation[0].col(OpenManipulatorJoint2::axis() - AXIS_X);
+  jacobian->block<3, 1>(3, 2) = orientation[1].col(OpenManipulatorJoint3::axis() - AXIS_X);
+  jacobian->block<3, 1>(3, 3) = orientation[2].col(OpenManipulatorJoint4::axis() - AXIS_X);
+
+  for (int8_t index = 0; index < 4; index++)
+    jacobian->block<3, 1>(0, index) = jacobian->block<3, 1>(3, index).cross(position[4] - position[index]);
 }
 
+void OpenManipulatorChainStatic::forwardKinematics(Manipulator *manipulator)
+{
+  if (checkDescription(manipulator) == false)
+  {
+    Chain::forwardKinematics(manipulator);
+    return;
+  }
+
+  double joint_value[4];
+  Eigen::Vector3d position[5];
+  Eigen::Matrix3d orientation[5];
+
+  for (int8_t index = 0; index < 4; index++)
+    joint_value[index] = manipulator->getValue(link_name_[index]);
+
+  forward(joint_value, position, orientation);
+
+  for (int8_t index = 0; index < 5; index++)
+  {
+    manipulator->setComponentPositionFromWorld(link_name_[index], position[index]);
+    manipulator->setComponentOrientationFromWorld(link_name_[index], orientation[index]);
+  }
+  publishState(manipulator);
+}
+
+Eigen::MatrixXd OpenManipulatorChainStatic::jacobian(Manipulator *manipulator, Name tool_name)
+{
+  if (checkDescription(manipulator) == false || tool_name != link_name_[4])
+    return Chain::jacobian(manipulator, tool_name);
 
+  double joint_value[4];
+  Eigen::Vector3d position[5];
+  Eigen::Matrix3d orientation[5];
+  Eigen::Matrix<double, 6, 4> jacobian;
+
+  for (int8_t index = 0; index < 4; index++)
+    joint_value[index] = manipulator->getValue(link_name_[index]);
+
+  forwardWithJacobian(joint_value, position, orientation, &jacobian);
+  return jacobian;
+}
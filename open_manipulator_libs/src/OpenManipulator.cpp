@@ -19,11 +19,23 @@
 #include "../include/open_manipulator_libs/OpenManipulator.h"
 
 OPEN_MANIPULATOR::OPEN_MANIPULATOR()
-{}
+  :dxl_bus_(NULL),
+   task_velocity_time_(0.0),
+   task_velocity_previous_time_(0.0),
+   gravity_compensation_mode_(false)
+{
+  task_velocity_.tool_index = -1;
+  task_velocity_.twist.setZero();
+  task_velocity_.timeout = 0.0;
+}
 OPEN_MANIPULATOR::~OPEN_MANIPULATOR()
-{}
+{
+  if(dxl_bus_ != NULL)
+    dxl_bus_->stopIOThread();
+}
 
-void OPEN_MANIPULATOR::initManipulator(bool using_platform, STRING usb_port, STRING baud_rate)
+void OPEN_MANIPULATOR::initManipulator(bool using_platform, STRING usb_port, STRING baud_rate, STRING kinematics,
+                                       STRING joint_mode, const URDF::Model *dynamics_description)
 {
   platform_ = using_platform;
   ////////// manipulator parameter initialization
@@ -38,8 +50,8 @@ void OPEN_MANIPULATOR::initManipulator(bool using_platform, STRING usb_port, STR
            RM_MATH::convertRPYToRotation(0.0, 0.0, 0.0), // relative orientation
            Z_AXIS, // axis of rotation
            11,     // actuator id
-           M_PI,   // max joint limit (3.14 rad)
-           -M_PI); // min joint limit (-3.14 rad)
+           JOINT1_MAX_LIMIT,   // max joint limit (3.14 rad)
+           JOINT1_MIN_LIMIT);  // min joint limit (-3.14 rad)
 
 
   addJoint("joint2", // my name
@@ -49,8 +61,8 @@ void OPEN_MANIPULATOR::initManipulator(bool using_platform, STRING usb_port, STR
            RM_MATH::convertRPYToRotation(0.0, 0.0, 0.0), // relative orientation
            Y_AXIS, // axis of rotation
            12,     // actuator id
-           M_PI_2,   // max joint limit (1.67 rad)
-           -2.05); // min joint limit (-2.05 rad)
+           JOINT2_MAX_LIMIT,   // max joint limit (1.67 rad)
+           JOINT2_MIN_LIMIT);  // min joint limit (-2.05 rad)
 
   addJoint("joint3", // my name
            "joint2", // parent name
@@ -59,8 +71,8 @@ void OPEN_MANIPULATOR::initManipulator(bool using_platform, STRING usb_port, STR
            RM_MATH::convertRPYToRotation(0.0, 0.0, 0.0), // relative orientation
            Y_AXIS, // axis of rotation
            13,     // actuator id
-           1.53,      // max joint limit (1.53 rad)
-           -M_PI_2); // min joint limit (-1.67 rad)
+           JOINT3_MAX_LIMIT,   // max joint limit (1.53 rad)
+           JOINT3_MIN_LIMIT);  // min joint limit (-1.67 rad)
 
   addJoint("joint4", // my name
            "joint3", // parent name
@@ -69,8 +81,8 @@ void OPEN_MANIPULATOR::initManipulator(bool using_platform, STRING usb_port, STR
            RM_MATH::convertRPYToRotation(0.0, 0.0, 0.0), // relative orientation
            Y_AXIS, // axis of rotation
            14,     // actuator id
-           2.0,    // max joint limit (2.0 rad)
-           -1.8);  // min joint limit (-1.8 rad)
+           JOINT4_MAX_LIMIT,   // max joint limit (2.0 rad)
+           JOINT4_MIN_LIMIT);  // min joint limit (-1.8 rad)
 
   addTool("gripper",   // my name
           "joint4", // parent name
@@ -82,15 +94,41 @@ void OPEN_MANIPULATOR::initManipulator(bool using_platform, STRING usb_port, STR
           -0.015); // Change unit from `meter` to `radian`
 
   ////////// kinematics init.
-  kinematics_ = new KINEMATICS::Chain();
+  if(kinematics == "chain_static")
+    kinematics_ = new KINEMATICS::OpenManipulatorChainStatic(); // description above compiled in
+  else
+    kinematics_ = new KINEMATICS::Chain();
   addKinematics(kinematics_);
+  kinematics_->buildForwardKinematicsPlan(getManipulator());
+  kinematics_->setJointLimit("joint1", JOINT1_MAX_LIMIT, JOINT1_MIN_LIMIT);
+  kinematics_->setJointLimit("joint2", JOINT2_MAX_LIMIT, JOINT2_MIN_LIMIT);
+  kinematics_->setJointLimit("joint3", JOINT3_MAX_LIMIT, JOINT3_MIN_LIMIT);
+  kinematics_->setJointLimit("joint4", JOINT4_MAX_LIMIT, JOINT4_MIN_LIMIT);
   STRING inverse_option[2] = {"inverse_solver", "chain_custum_inverse_kinematics"};
+//  STRING inverse_option[2] = {"inverse_solver", "analytic_inverse"};
 //  STRING inverse_option[2] = {"inverse_solver", "sr_inverse"};
 //  STRING inverse_option[2] = {"inverse_solver", "position_only_inverse"};
 //  STRING inverse_option[2] = {"inverse_solver", "normal_inverse"};
   void *inverse_option_arg = &inverse_option;
   kinematicsSetOption(inverse_option_arg);
 
+  // accept the best so far of a solve cut by the deadline when it is close enough (about 0.5 mm)
+  STRING approximate_option[2] = {"ik_approximate_tolerance", "1E-6"};
+  void *approximate_option_arg = &approximate_option;
+  kinematicsSetOption(approximate_option_arg);
+
+  // joint limit envelope of the task space goals (after the joint limits)
+  kinematics_->buildWorkspaceEnvelope(getManipulator(), "gripper");
+
+  ////////// link inertials and joint control mode, before the actuators are enabled
+  if(dynamics_description != NULL)
+    loadDynamics(*dynamics_description);
+
+  if(checkJointControlMode(joint_mode) == false)
+    joint_mode = "position_mode";
+  gravity_compensation_mode_ = (joint_mode == "gravity_compensation_mode");
+  hold_goal_value_.clear();
+
   if(platform_)
   {
     ////////// joint actuator init.
@@ -106,6 +144,7 @@ void OPEN_MANIPULATOR::initManipulator(bool using_platform, STRING usb_port, STR
     jointDxlId.push_back(14);
 
     addJointActuator(JOINT_DYNAMIXEL, actuator_, jointDxlId, p_dxl_comm_arg);
+    dxl_bus_ = DYNAMIXEL::DynamixelBus::getBus(usb_port, baud_rate); // joints and gripper share it
 
     // set joint actuator parameter
     STRING joint_dxl_opt_arg[2] = {"Return_Delay_Time", "0"};
@@ -113,7 +152,7 @@ void OPEN_MANIPULATOR::initManipulator(bool using_platform, STRING usb_port, STR
     jointActuatorSetMode(JOINT_DYNAMIXEL, jointDxlId, p_joint_dxl_opt_arg);
 
     // set joint actuator control mode
-    STRING joint_dxl_mode_arg = "position_mode";
+    STRING joint_dxl_mode_arg = joint_mode;
     void *p_joint_dxl_mode_arg = &joint_dxl_mode_arg;
     jointActuatorSetMode(JOINT_DYNAMIXEL, jointDxlId, p_joint_dxl_mode_arg);
 
@@ -141,6 +180,17 @@ void OPEN_MANIPULATOR::initManipulator(bool using_platform, STRING usb_port, STR
     gripper_dxl_opt_arg[1] = "200";
     toolActuatorSetMode(TOOL_DYNAMIXEL, p_gripper_dxl_opt_arg);
 
+    // voltage, temperature and hardware error on the read of the present values
+    dxl_bus_->setIndirectAddress();
+
+    ActuatorMonitorValue actuator_monitor;
+    actuator_monitor.actuator_id = dxl_bus_->getId();
+    actuator_monitor.available.assign(actuator_monitor.actuator_id.size(), 0);
+    actuator_monitor.voltage.assign(actuator_monitor.actuator_id.size(), 0.0);
+    actuator_monitor.temperature.assign(actuator_monitor.actuator_id.size(), 0.0);
+    actuator_monitor.hardware_error.assign(actuator_monitor.actuator_id.size(), 0);
+    actuator_monitor_buffer_.fill(actuator_monitor);
+
     // all actuator enable
     allActuatorEnable();
     receiveAllJointActuatorValue();
@@ -154,6 +204,13 @@ void OPEN_MANIPULATOR::initManipulator(bool using_platform, STRING usb_port, STR
 
   ////////// manipulator trajectory & control time initialization
   setTrajectoryControlTime(CONTROL_TIME);
+
+  ////////// singularity monitor
+  tool_name_ = getManipulator()->getAllToolComponentName();
+  ManipulabilityValue manipulability;
+  manipulability.manipulability.assign(tool_name_.size(), 0.0);
+  manipulability.min_singular_value.assign(tool_name_.size(), 0.0);
+  manipulability_buffer_.fill(manipulability);
 }
 
 void OPEN_MANIPULATOR::openManipulatorProcess(double present_time)
@@ -161,12 +218,36 @@ void OPEN_MANIPULATOR::openManipulatorProcess(double present_time)
   std::vector<WayPoint> goal_value  = getJointGoalValueFromTrajectory(present_time);
   std::vector<double> tool_value    = getToolGoalValue();
 
+  if(goal_value.size() == 0)
+    goal_value = getJointGoalValueFromTaskVelocity(present_time);
+  else // a trajectory cancels the streaming control
+    task_velocity_.timeout = 0.0;
+
+  if(gravity_compensation_mode_)
+  {
+    if(goal_value.size() == 0)
+      goal_value = getHoldGoalValue();
+    else
+      hold_goal_value_ = goal_value;
+  }
+
+  if(goal_value.size() != 0)
+    setGoalJointEffort(&goal_value);
+
   if(platform_)
   {
     receiveAllJointActuatorValue();
     receiveAllToolActuatorValue();
+
+    ActuatorMonitorValue &actuator_monitor = actuator_monitor_buffer_.getWriteBuffer();
+    for(uint8_t index = 0; index < actuator_monitor.actuator_id.size(); index++)
+      actuator_monitor.available.at(index) = dxl_bus_->getMonitorValue(actuator_monitor.actuator_id.at(index), &actuator_monitor.voltage.at(index),
+                                                                         &actuator_monitor.temperature.at(index), &actuator_monitor.hardware_error.at(index));
+    actuator_monitor_buffer_.publish();
+
     if(goal_value.size() != 0) sendAllJointActuatorValue(goal_value);
     if(tool_value.size() != 0) sendAllToolActuatorValue(tool_value);
+    dxl_bus_->endControlCycle(); // staged goals not written yet, or the next cycle of the bus thread
   }
   else // visualization
   {
@@ -174,6 +255,303 @@ void OPEN_MANIPULATOR::openManipulatorProcess(double present_time)
     if(tool_value.size() != 0) setAllToolValue(tool_value);
   }
   forwardKinematics();
+
+  ManipulabilityValue &manipulability = manipulability_buffer_.getWriteBuffer();
+  for(uint8_t index = 0; index < tool_name_.size(); index++)
+    kinematics_->manipulability(getManipulator(), tool_name_.at(index), &manipulability.manipulability.at(index), &manipulability.min_singular_value.at(index));
+  manipulability_buffer_.publish();
+}
+
+bool OPEN_MANIPULATOR::loadReachabilityMap(STRING file_name, double resolution)
+{
+  if (kinematics_->loadReachabilityMap(file_name))
+    return true;
+
+  // generate once (offline work, takes a few seconds) and use it from the next time
+  RM_LOG::INFO("Generate the reachability map : " + file_name);
+  if (kinematics_->generateReachabilityMap(getManipulator(), "gripper", resolution, file_name) == false)
+    return false;
+
+  return kinematics_->loadReachabilityMap(file_name);
+}
+
+bool OPEN_MANIPULATOR::loadDynamics(const URDF::Model &description)
+{
+  if (dynamics_.build(getManipulator(), "gripper") == false)
+    return false;
+  return dynamics_.loadDescription(description);
+}
+
+bool OPEN_MANIPULATOR::isDynamicsLoaded()
+{
+  return dynamics_.isLoaded();
+}
+
+bool OPEN_MANIPULATOR::loadCollision(const URDF::Model &description)
+{
+  if (collision_.build(getManipulator(), "gripper") == false)
+    return false;
+  return collision_.loadDescription(description);
+}
+
+bool OPEN_MANIPULATOR::isCollisionFree(std::vector<double> goal_joint_value, STRING *reason)
+{
+  if(collision_.isLoaded() == false)
+    return true;
+
+  std::vector<double> present_joint_value;
+  if(getPresentJointValue(&present_joint_value) == false)
+    return true;
+
+  // a joint trajectory moves on the straight line of the joint space
+  return (collision_.isPathCollided(present_joint_value, goal_joint_value, 0.02, reason) == false);
+}
+
+bool OPEN_MANIPULATOR::getPresentJointValue(std::vector<double> *joint_value)
+{
+  // published by the FK pass of the control thread, never the manipulator it is writing
+  return kinematics_->getPresentJointValue(getManipulator(), "gripper", joint_value);
+}
+
+bool OPEN_MANIPULATOR::checkTaskSpaceGoal(Name tool_name, Pose target_pose, STRING *reason)
+{
+  return kinematics_->checkTaskSpaceGoal(getManipulator(), tool_name, target_pose, reason);
+}
+
+bool OPEN_MANIPULATOR::checkTaskSpaceGoal(Name tool_name, Eigen::Vector3d target_position, STRING *reason)
+{
+  // the position only move keeps the present orientation
+  Pose target_pose;
+  target_pose.position = target_position;
+  target_pose.orientation = Eigen::Matrix3d::Identity();
+  return kinematics_->checkTaskSpaceGoal(getManipulator(), tool_name, target_pose, reason, KINEMATICS::TASK_GOAL_KEEP_ORIENTATION);
+}
+
+bool OPEN_MANIPULATOR::checkTaskSpaceGoal(Name tool_name, Eigen::Matrix3d target_orientation, STRING *reason)
+{
+  // the orientation only move keeps the present position
+  Pose target_pose;
+  target_pose.position = Eigen::Vector3d::Zero();
+  target_pose.orientation = target_orientation;
+  return kinematics_->checkTaskSpaceGoal(getManipulator(), tool_name, target_pose, reason, KINEMATICS::TASK_GOAL_KEEP_POSITION);
+}
+
+void OPEN_MANIPULATOR::setGoalJointEffort(std::vector<WayPoint> *goal_value)
+{
+  if(dynamics_.isLoaded() == false || goal_value->size() != (uint8_t)dynamics_.getDOF())
+    return;
+
+  goal_joint_value_.resize(goal_value->size());
+  goal_joint_velocity_.resize(goal_value->size());
+  goal_joint_acceleration_.resize(goal_value->size());
+  for(uint8_t index = 0; index < goal_value->size(); index++)
+  {
+    goal_joint_value_.at(index) = goal_value->at(index).value;
+    goal_joint_velocity_.at(index) = goal_value->at(index).velocity;
+    goal_joint_acceleration_.at(index) = goal_value->at(index).acceleration;
+  }
+
+  if(dynamics_.inverseDynamics(goal_joint_value_, goal_joint_velocity_, goal_joint_acceleration_, &goal_joint_torque_) == false)
+    return;
+
+  for(uint8_t index = 0; index < goal_value->size(); index++)
+    goal_value->at(index).effort = goal_joint_torque_.at(index); // N*m
+}
+
+std::vector<WayPoint> OPEN_MANIPULATOR::getHoldGoalValue()
+{
+  if(hold_goal_value_.size() == 0)
+    hold_goal_value_ = getAllActiveJointValue();
+
+  for(uint8_t index = 0; index < hold_goal_value_.size(); index++)
+  {
+    hold_goal_value_.at(index).velocity = 0.0;
+    hold_goal_value_.at(index).acceleration = 0.0;
+    hold_goal_value_.at(index).effort = 0.0;
+  }
+  return hold_goal_value_;
+}
+
+bool OPEN_MANIPULATOR::checkJointControlMode(STRING joint_mode)
+{
+  if(joint_mode != "position_mode" && joint_mode != "gravity_compensation_mode")
+  {
+    RM_LOG::ERROR("Unknown joint control mode : " + joint_mode);
+    return false;
+  }
+  if(joint_mode == "gravity_compensation_mode" && dynamics_.isLoaded() == false)
+  {
+    RM_LOG::ERROR("Gravity compensation mode needs the link inertials (loadDynamics)");
+    return false;
+  }
+  return true;
+}
+
+bool OPEN_MANIPULATOR::setJointControlMode(STRING joint_mode)
+{
+  if(checkJointControlMode(joint_mode) == false)
+    return false;
+
+  // the operating mode is changed with the torque off (the joints go limp for a moment), set it before moving
+  if(platform_)
+  {
+    void *p_joint_dxl_mode_arg = &joint_mode;
+    jointActuatorSetMode(JOINT_DYNAMIXEL, jointDxlId, p_joint_dxl_mode_arg);
+  }
+  gravity_compensation_mode_ = (joint_mode == "gravity_compensation_mode");
+  hold_goal_value_.clear();
+  return true;
+}
+
+STRING OPEN_MANIPULATOR::getJointControlMode()
+{
+  return gravity_compensation_mode_ ? "gravity_compensation_mode" : "position_mode";
+}
+
+bool OPEN_MANIPULATOR::setBusThread(bool using_thread)
+{
+  if(platform_ == false || dxl_bus_ == NULL)
+    return false;
+
+  if(using_thread)
+    return dxl_bus_->startIOThread();
+
+  dxl_bus_->stopIOThread();
+  return true;
+}
+
+bool OPEN_MANIPULATOR::getActuatorMonitor(uint8_t actuator_id, double *voltage, double *temperature, uint8_t *hardware_error)
+{
+  if(platform_ == false || dxl_bus_ == NULL)
+    return false;
+
+  // the last cycle, the items of an id from the same read
+  actuator_monitor_buffer_.take();
+  const ActuatorMonitorValue &value = actuator_monitor_buffer_.getReadBuffer();
+
+  for(uint8_t index = 0; index < value.actuator_id.size(); index++)
+  {
+    if(value.actuator_id.at(index) == actuator_id)
+    {
+      if(value.available.at(index) == 0)
+        return false;
+      *voltage = value.voltage.at(index);
+      *temperature = value.temperature.at(index);
+      *hardware_error = value.hardware_error.at(index);
+      return true;
+    }
+  }
+  return false;
+}
+
+std::vector<uint8_t> OPEN_MANIPULATOR::getActuatorId()
+{
+  if(platform_ == false || dxl_bus_ == NULL)
+    return std::vector<uint8_t>();
+
+  return actuator_monitor_buffer_.getReadBuffer().actuator_id; // same in every buffer
+}
+
+void OPEN_MANIPULATOR::setKinematicsDeadline(double deadline)
+{
+  kinematics_->setDeadline(deadline);
+}
+
+void OPEN_MANIPULATOR::setIKMultiStart(bool using_multi_start)
+{
+  // solve from the present, mirrored elbow and map seeds, keep the in-limit solution nearest to the present
+  STRING multi_start_option[2] = {"ik_multi_start", using_multi_start ? "true" : "false"};
+  void *multi_start_option_arg = &multi_start_option;
+  kinematicsSetOption(multi_start_option_arg);
+}
+
+void OPEN_MANIPULATOR::setTaskVelocity(Name tool_name, KINEMATICS::Vector6d twist, double timeout)
+{
+  int8_t tool_index = -1;
+  for(uint8_t index = 0; index < tool_name_.size(); index++)
+  {
+    if(tool_name_.at(index) == tool_name)
+      tool_index = index;
+  }
+  if(tool_index < 0)
+  {
+    RM_LOG::WARN("[task velocity]no tool named " + tool_name);
+    return;
+  }
+
+  // one writer thread at a time (the callbacks of the controller)
+  TaskVelocityCommand &command = task_velocity_buffer_.getWriteBuffer();
+  command.tool_index = tool_index;
+  command.twist = twist;
+  command.timeout = timeout;
+  task_velocity_buffer_.publish();
+}
+
+std::vector<WayPoint> OPEN_MANIPULATOR::getJointGoalValueFromTaskVelocity(double present_time)
+{
+  std::vector<WayPoint> goal_value;
+
+  if(task_velocity_buffer_.take())
+  {
+    task_velocity_ = task_velocity_buffer_.getReadBuffer();
+    task_velocity_time_ = present_time;
+  }
+
+  if(task_velocity_.tool_index < 0 || present_time - task_velocity_time_ > task_velocity_.timeout)
+  {
+    // next stream starts from the present joint values
+    task_velocity_goal_.clear();
+    return goal_value;
+  }
+
+  double time_step = CONTROL_TIME;
+  if(task_velocity_goal_.size() != 0)
+    time_step = present_time - task_velocity_previous_time_;
+  task_velocity_previous_time_ = present_time;
+
+  std::vector<double> previous_goal = task_velocity_goal_;
+  if(kinematics_->resolvedRate(getManipulator(), tool_name_.at(task_velocity_.tool_index), task_velocity_.twist, time_step, &task_velocity_goal_) == false)
+  {
+    task_velocity_.timeout = 0.0;
+    task_velocity_goal_.clear();
+    return goal_value;
+  }
+
+  for(uint8_t index = 0; index < task_velocity_goal_.size(); index++)
+  {
+    WayPoint joint_goal;
+    joint_goal.value = task_velocity_goal_.at(index);
+    joint_goal.velocity = 0.0;
+    if(previous_goal.size() == task_velocity_goal_.size() && time_step > 0.0)
+      joint_goal.velocity = (task_velocity_goal_.at(index) - previous_goal.at(index)) / time_step;
+    joint_goal.acceleration = 0.0;
+    joint_goal.effort = 0.0;
+    goal_value.push_back(joint_goal);
+  }
+  return goal_value;
+}
+
+bool OPEN_MANIPULATOR::getManipulability(Name tool_name, double *manipulability, double *min_singular_value)
+{
+  // the last cycle, both values from the same one
+  manipulability_buffer_.take();
+  const ManipulabilityValue &value = manipulability_buffer_.getReadBuffer();
+
+  for(uint8_t index = 0; index < tool_name_.size(); index++)
+  {
+    if(tool_name_.at(index) == tool_name)
+    {
+      *manipulability = value.manipulability.at(index);
+      *min_singular_value = value.min_singular_value.at(index);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool OPEN_MANIPULATOR::getManipulability(Name tool_name, std::vector<double> joint_value, double *manipulability, double *min_singular_value)
+{
+  return kinematics_->manipulability(getManipulator(), tool_name, manipulability, min_singular_value, &joint_value);
 }
 
 bool OPEN_MANIPULATOR::getPlatformFlag()
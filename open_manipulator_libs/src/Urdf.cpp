@@ -0,0 +1,77 @@
+﻿/*******************************************************************************
+* Copyright 2018 ROBOTIS CO., LTD.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+
+/* Authors: Darby Lim, Hye-Jong KIM, Ryan Shim, Yong-Ho Na */
+
+#include "../include/open_manipulator_libs/Urdf.h"
+
+#include <algorithm>
+
+using namespace URDF;
+
+//-------------------- Model --------------------//
+
+void Model::clear()
+{
+  link_.clear();
+  joint_of_child_.clear();
+}
+
+void Model::addLink(Name link_name, const Link &link)
+{
+  link_[link_name] = link;
+}
+
+void Model::addJoint(const Joint &joint)
+{
+  joint_of_child_[joint.child] = joint;
+}
+
+const Joint *Model::findJoint(Name joint_name) const
+{
+  for (std::map<Name, Joint>::const_iterator it = joint_of_child_.begin(); it != joint_of_child_.end(); it++)
+  {
+    if (it->second.name == joint_name)
+      return &it->second;
+  }
+  return NULL;
+}
+
+bool Model::findCarryingJoint(Name link_name, const std::vector<Name> &active_joint,
+                              Name *joint_name, Eigen::Vector3d *position, Eigen::Matrix3d *rotation) const
+{
+  position->setZero();
+  rotation->setIdentity();
+
+  Name link = link_name;
+  while (true)
+  {
+    std::map<Name, Joint>::const_iterator it = joint_of_child_.find(link);
+    if (it == joint_of_child_.end())
+      return false; // root
+
+    if (std::find(active_joint.begin(), active_joint.end(), it->second.name) != active_joint.end())
+    {
+      *joint_name = it->second.name;
+      return true;
+    }
+
+    // fixed (or not on the chain) : its child link is moved onto the parent link frame
+    *position = it->second.rotation * (*position) + it->second.origin;
+    *rotation = it->second.rotation * (*rotation);
+    link = it->second.parent;
+  }
+}
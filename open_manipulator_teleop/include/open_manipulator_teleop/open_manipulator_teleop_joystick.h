@@ -3,6 +3,7 @@
 
 #include <ros/ros.h>
 #include <sensor_msgs/JointState.h>
+#include <geometry_msgs/Twist.h>
 #include <sensor_msgs/Joy.h>
 
 #include <termios.h>
@@ -28,6 +29,8 @@ class OM_TELEOP
   ros::ServiceClient goal_joint_space_path_client_;
   ros::ServiceClient goal_tool_control_client_;
 
+  ros::Publisher goal_task_space_velocity_pub_;
+
   ros::Subscriber chain_joint_states_sub_;
   ros::Subscriber chain_kinematics_pose_sub_;
   ros::Subscriber joy_command_sub_;
@@ -35,6 +38,9 @@ class OM_TELEOP
   std::vector<double> present_joint_angle;
   std::vector<double> present_kinematic_position;
 
+  // m/s, DELTA per command : the controller integrates a velocity for its task_velocity_timeout
+  double task_velocity_;
+
  public:
 
   OM_TELEOP();
@@ -53,6 +59,7 @@ class OM_TELEOP
   bool setJointSpacePath(std::vector<std::string> joint_name, std::vector<double> joint_angle, double path_time);
   bool setTaskSpacePathToPresent(std::vector<double> kinematics_pose, double path_time);
   bool setToolControl(std::vector<double> joint_angle);
+  void setTaskSpaceVelocity(std::vector<double> linear_velocity);
 
   void setGoal(const char *str);
 };
@@ -3,6 +3,7 @@
 
 #include <ros/ros.h>
 #include <sensor_msgs/JointState.h>
+#include <geometry_msgs/Twist.h>
 
 #include <termios.h>
 #include "open_manipulator_msgs/SetJointPosition.h"
@@ -28,12 +29,17 @@ class OM_TELEOP
   ros::ServiceClient goal_joint_space_path_client_;
   ros::ServiceClient goal_tool_control_client_;
 
+  ros::Publisher goal_task_space_velocity_pub_;
+
   ros::Subscriber chain_joint_states_sub_;
   ros::Subscriber chain_kinematics_pose_sub_;
 
   std::vector<double> present_joint_angle;
   std::vector<double> present_kinematic_position;
 
+  // m/s, DELTA per command : the controller integrates a velocity for its task_velocity_timeout
+  double task_velocity_;
+
   struct termios oldt;
 
  public:
@@ -54,6 +60,7 @@ class OM_TELEOP
   bool setJointSpacePath(std::vector<std::string> joint_name, std::vector<double> joint_angle, double path_time);
   bool setTaskSpacePathToPresent(std::vector<double> kinematics_pose, double path_time);
   bool setToolControl(std::vector<double> joint_angle);
+  void setTaskSpaceVelocity(std::vector<double> linear_velocity);
 
   void printText();
   void setGoal(char ch);
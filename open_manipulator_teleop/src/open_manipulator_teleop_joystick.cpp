@@ -27,6 +27,12 @@ OM_TELEOP::OM_TELEOP()
   present_joint_angle.resize(NUM_OF_JOINT);
   present_kinematic_position.resize(3);
 
+  // same timeout as the controller (task_velocity_timeout of its launch file)
+  double task_velocity_timeout = priv_node_handle_.param<double>("task_velocity_timeout", 0.1);
+  if (task_velocity_timeout <= 0.0)
+    task_velocity_timeout = 0.1;
+  task_velocity_ = DELTA / task_velocity_timeout;
+
   initPublisher();
   initSubscriber();
 
@@ -47,6 +53,7 @@ void OM_TELEOP::initPublisher()
   goal_task_space_path_to_present_client_ = node_handle_.serviceClient<open_manipulator_msgs::SetKinematicsPose>("goal_task_space_path_to_present");
   goal_joint_space_path_client_ = node_handle_.serviceClient<open_manipulator_msgs::SetJointPosition>("goal_joint_space_path");
   goal_tool_control_client_ = node_handle_.serviceClient<open_manipulator_msgs::SetJointPosition>("goal_tool_control");
+  goal_task_space_velocity_pub_ = node_handle_.advertise<geometry_msgs::Twist>("goal_task_space_velocity", 10);
 
 }
 void OM_TELEOP::initSubscriber()
@@ -144,46 +151,57 @@ bool OM_TELEOP::setTaskSpacePathToPresent(std::vector<double> kinematics_pose, d
   return false;
 }
 
+void OM_TELEOP::setTaskSpaceVelocity(std::vector<double> linear_velocity)
+{
+  // streamed to the controller, no trajectory is planned for it
+  geometry_msgs::Twist msg;
+  msg.linear.x = linear_velocity.at(0);
+  msg.linear.y = linear_velocity.at(1);
+  msg.linear.z = linear_velocity.at(2);
+
+  goal_task_space_velocity_pub_.publish(msg);
+}
+
 void OM_TELEOP::setGoal(const char* str)
 {
-  std::vector<double> goalPose;  goalPose.resize(3, 0.0);
+  std::vector<double> goalVelocity;  goalVelocity.resize(3, 0.0);
   std::vector<double> goalJoint; goalJoint.resize(4, 0.0);
 
   if(str == "x+")
   {
     printf("increase(++) x axis in cartesian space\n");
-    goalPose.at(0) = DELTA;
-    setTaskSpacePathToPresent(goalPose, PATH_TIME);
+    goalVelocity.at(0) = task_velocity_;
+    setTaskSpaceVelocity(goalVelocity);
   }
   else if(str == "x-")
   {
     printf("decrease(--) x axis in cartesian space\n");
-    goalPose.at(0) = -DELTA;
-    setTaskSpacePathToPresent(goalPose, PATH_TIME);
+    goalVelocity.at(0) = -task_velocity_;
+    setTaskSpaceVelocity(goalVelocity);
   }
   else if(str == "y+")
   {
     printf("increase(++) y axis in cartesian space\n");
-    goalPose.at(1) = DELTA;
-    setTaskSpacePathToPresent(goalPose, PATH_TIME);
+    goalVelocity.at(1) = task_velocity_;
+    setTaskSpaceVelocity(goalVelocity);
   }
   else if(str == "y-")
   {
     printf("decrease(--) y axis in cartesian space\n");
-    goalPose.at(1) = -DELTA;
-    setTaskSpacePathToPresent(goalPose, PATH_TIME);
+    goalVelocity.at(1) = -task_velocity_;
+    setTaskSpaceVelocity(goalVelocity);
   }
   else if(str == "z+")
   {
     printf("increase(++) z axis in cartesian space\n");
-    goalPose.at(2) = DELTA;
-    setTaskSpacePathToPresent(goalPose, PATH_TIME);
+    goalVelocity.at(2) = task_velocity_;
+    setTaskSpaceVelocity(goalVelocity);
   }
   else if(str == "z-")
   {
     printf("decrease(--) z axis in cartesian space\n");
-    goalPose.at(2) = -DELTA;
-    setTaskSpacePathToPresent(goalPose, PATH_TIME);
+    goalVelocity.at(2) = -task_velocity_;
+    setTaskSpaceVelocity(goalVelocity);
   }
 
   else if(str == "gripper open")